@@ -0,0 +1,102 @@
+// Throughput of the entropy coders in io/entropy.h
+// g++ -std=c++17 -O3 -march=native -I src bench/io/entropy.cxx
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "io/entropy.h"
+#include "io/inbuf.h"
+#include "io/outbuf.h"
+
+constexpr std::size_t count = 1u << 22;
+constexpr std::size_t bytes = 64u << 20;
+
+using clk = std::chrono::steady_clock;
+using wbuf = bcbuf<bytes, bitorder::msb>;
+using rbuf = bcreader<bitorder::msb>;
+
+static wbuf out;
+
+template <typename E, typename D>
+void bench(const char* name, E encode, D decode){
+    out.reset();
+    auto t0 = clk::now();
+    encode();
+    auto t1 = clk::now();
+    rbuf in(out.data().data(), (out.bits() + 7) / 8);
+    std::uint64_t sum = decode(in);
+    auto t2 = clk::now();
+
+    double enc = std::chrono::duration<double>(t1 - t0).count();
+    double dec = std::chrono::duration<double>(t2 - t1).count();
+    double mb = out.bits() / 8e6;
+    std::printf("%-12s %7.1f MB  enc %8.1f Mval/s %8.1f MB/s  dec %8.1f Mval/s %8.1f MB/s  (%llu)\n",
+                name, mb, count / enc / 1e6, mb / enc, count / dec / 1e6, mb / dec,
+                static_cast<unsigned long long>(sum));
+}
+
+int main(){
+    std::mt19937_64 gen(42);
+    // Geometric-like values typical for residuals and run lengths
+    std::geometric_distribution<std::uint32_t> geo(0.05);
+    std::vector<std::uint32_t> values(count);
+    for(auto& v: values){
+        v = geo(gen);
+    }
+
+    bench("exp-golomb", [&]{
+        for(auto v: values){
+            writeUE(out, v);
+        }
+    }, [&](rbuf& in){
+        std::uint64_t sum = 0;
+        for(std::size_t i = 0; i != count; ++i){
+            sum += readUE(in);
+        }
+        return sum;
+    });
+
+    bench("signed e-g", [&]{
+        for(auto v: values){
+            writeSE(out, static_cast<std::int64_t>(v) - 10);
+        }
+    }, [&](rbuf& in){
+        std::uint64_t sum = 0;
+        for(std::size_t i = 0; i != count; ++i){
+            sum += static_cast<std::uint64_t>(readSE(in));
+        }
+        return sum;
+    });
+
+    bench("rice k=4", [&]{
+        for(auto v: values){
+            writeRice(out, v, 4);
+        }
+    }, [&](rbuf& in){
+        std::uint64_t sum = 0;
+        for(std::size_t i = 0; i != count; ++i){
+            sum += readRice(in, 4);
+        }
+        return sum;
+    });
+
+    std::vector<std::uint64_t> freq(256, 0);
+    for(auto& v: values){
+        v &= 0xffu;
+        ++freq[v];
+    }
+    huffman<bitorder::msb> code(freq);
+    bench("huffman", [&]{
+        for(auto v: values){
+            code.encode(out, v);
+        }
+    }, [&](rbuf& in){
+        std::uint64_t sum = 0;
+        for(std::size_t i = 0; i != count; ++i){
+            sum += code.decode(in);
+        }
+        return sum;
+    });
+}
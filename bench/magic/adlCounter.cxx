@@ -0,0 +1,32 @@
+// Compile-time cost of constexpr_counter in magic/adl_counter.h.
+// Nothing runs at runtime, the benchmark is the compilation itself:
+// COUNT (1, 10, 100, 1000 or 10000) selects the number of increments.
+// bench/magic/adlCounter.sh reports time and peak memory for each count.
+
+#include "magic/adl_counter.h"
+
+using Counter = constexpr_counter<struct BenchTag, int, 0, 1>;
+
+#define ADL_STEP1     static_assert(Counter::next() > 0, "");
+#define ADL_STEP10    ADL_STEP1    ADL_STEP1    ADL_STEP1    ADL_STEP1    ADL_STEP1 \
+                      ADL_STEP1    ADL_STEP1    ADL_STEP1    ADL_STEP1    ADL_STEP1
+#define ADL_STEP100   ADL_STEP10   ADL_STEP10   ADL_STEP10   ADL_STEP10   ADL_STEP10 \
+                      ADL_STEP10   ADL_STEP10   ADL_STEP10   ADL_STEP10   ADL_STEP10
+#define ADL_STEP1000  ADL_STEP100  ADL_STEP100  ADL_STEP100  ADL_STEP100  ADL_STEP100 \
+                      ADL_STEP100  ADL_STEP100  ADL_STEP100  ADL_STEP100  ADL_STEP100
+#define ADL_STEP10000 ADL_STEP1000 ADL_STEP1000 ADL_STEP1000 ADL_STEP1000 ADL_STEP1000 \
+                      ADL_STEP1000 ADL_STEP1000 ADL_STEP1000 ADL_STEP1000 ADL_STEP1000
+
+#define ADL_CAT(a, b)  ADL_CAT_(a, b)
+#define ADL_CAT_(a, b) a##b
+
+#ifndef COUNT
+#define COUNT 100
+#endif
+
+ADL_CAT(ADL_STEP, COUNT)
+
+static_assert(Counter::value() == COUNT, "Counter must advance once per increment");
+
+int main(){
+}
@@ -0,0 +1,25 @@
+#!/bin/sh
+# Compile time and peak memory of bench/magic/adlCounter.cxx
+# Usage: bench/magic/adlCounter.sh [compiler] (run from repository root)
+#
+# Measured with g++ 12.2 on one core:
+#     100 increments:    0.3 s,   47 MB
+#    1000 increments:    5.3 s,  292 MB
+#   10000 increments:  369 s,   3.1 GB
+# Nearly all of it is overload resolution of the adl_flag() friends, whose
+# cost grows with the number already declared, so the total is about
+# quadratic. The last count needs several minutes and over 3 GB.
+
+CXX=${1:-${CXX:-g++}}
+
+for count in 100 1000 10000; do
+    if [ -x /usr/bin/time ]; then
+        /usr/bin/time -f "$count increments: %e s, %M KB" \
+            "$CXX" -std=c++17 -Isrc -DCOUNT=$count -c bench/magic/adlCounter.cxx -o /dev/null
+    else
+        start=$(date +%s.%N)
+        "$CXX" -std=c++17 -Isrc -DCOUNT=$count -c bench/magic/adlCounter.cxx -o /dev/null
+        end=$(date +%s.%N)
+        echo "$count increments: $(awk "BEGIN{print $end - $start}") s"
+    fi
+done
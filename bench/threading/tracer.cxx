@@ -0,0 +1,71 @@
+// Cost of Tracer::record() and of tracing in EventEngine, see threading/tracer.h
+// g++ -std=c++17 -O3 -march=native -I src/threading bench/threading/tracer.cxx -lpthread
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include "evtEngine.h"
+#include "tracer.h"
+
+constexpr std::size_t count = 1u << 24;
+constexpr std::size_t events = 1u << 20;
+
+using clk = std::chrono::steady_clock;
+
+enum Ev{tick};
+
+static volatile std::uint64_t sink;
+
+template <typename F>
+void bench(const char* name, std::size_t n, F f){
+    auto t0 = clk::now();
+    f();
+    auto t1 = clk::now();
+    std::printf("%-24s %6.2f ns/op\n", name,
+                std::chrono::duration<double, std::nano>(t1 - t0).count() / n);
+}
+
+// Emit and poll events one queue lock at a time, per event cost
+template <unsigned P>
+void engine(const char* name){
+    EventEngine<Ev, P> ev(256);
+    ev.batch(256);
+    std::array<void(*)(), 1> cbs{[]{sink = sink + 1;}};
+    bench(name, events, [&]{
+        for(std::size_t i = 0; i < events; i += 256){
+            for(std::size_t j = 0; j != 256; ++j){
+                ev.emit(tick);
+            }
+            ev.poll(256, cbs.data());
+        }
+    });
+}
+
+int main(){
+#if defined(__x86_64__) || defined(__i386__)
+    bench("rdtsc", count, []{
+        std::uint64_t s = 0;
+        for(std::size_t i = 0; i != count; ++i){
+            s += __rdtsc();
+        }
+        sink = s;
+    });
+#endif
+    bench("record, disabled", count, []{
+        for(std::size_t i = 0; i != count; ++i){
+            Tracer::record(TraceKind::handlerBegin, i);
+        }
+    });
+    Tracer::enable(true);
+    bench("record, enabled", count, []{
+        for(std::size_t i = 0; i != count; ++i){
+            Tracer::record(TraceKind::handlerBegin, i);
+        }
+    });
+    engine<evtTraced>("engine, traced");
+    Tracer::enable(false);
+    engine<evtTraced>("engine, traced disabled");
+    engine<0>("engine, untraced");
+}
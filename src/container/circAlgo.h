@@ -0,0 +1,233 @@
+/*
+* Copyright (c) 2021 SdtElectronics . All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from this
+*    software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include "circBuf.h"
+#include "circIdxList.h"
+
+// Parallel algorithms over ccList, ccIdxList and ccBuf.
+// The circular sequence of size() elements starting from begin() is split
+// into balanced contiguous chunks, one per thread. The calling thread
+// processes the first chunk itself. threads == 0 uses all hardware threads.
+
+namespace detail{
+
+// Lists shorter than this many elements per thread are not worth splitting
+constexpr std::size_t ccGrain = 1u << 12;
+
+inline std::size_t ccChunks(std::size_t size, std::size_t threads){
+    if(threads == 0){
+        threads = std::thread::hardware_concurrency();
+    }
+    std::size_t n = size / ccGrain;
+    n = n < threads ? n : threads;
+    return n == 0 ? 1 : n;
+}
+
+// Offset of the first element of chunk i
+inline std::size_t ccChunkBegin(std::size_t size, std::size_t chunks, std::size_t i){
+    return size / chunks * i + (i < size % chunks ? i : size % chunks);
+}
+
+// Node of each chunk boundary, ccList has to walk the list once
+template<typename T, typename A>
+void ccSplit(const ccList<T, A>& list, std::vector<ccNode<T>*>& starts){
+    const std::size_t chunks = starts.size();
+    ccNode<T>* node = list.begin();
+    std::size_t offset = 0;
+    for(std::size_t i = 0; i != chunks; ++i){
+        for(std::size_t next = ccChunkBegin(list.size(), chunks, i); offset != next; ++offset){
+            node = node->next();
+        }
+        starts[i] = node;
+    }
+}
+
+// ccIdxList seeks every boundary through its skip index
+template<typename T, std::size_t K, typename A>
+void ccSplit(const ccIdxList<T, K, A>& list, std::vector<ccNode<T>*>& starts){
+    const std::size_t chunks = starts.size();
+    for(std::size_t i = 0; i != chunks; ++i){
+        starts[i] = typename ccIdxList<T, K, A>::iterator(
+                                list, ccChunkBegin(list.size(), chunks, i));
+    }
+}
+
+// Nodes of ccBuf are stored contiguously in one block
+template<typename T, typename A>
+void ccSplit(const ccBuf<T, A>& list, std::vector<ccNode<T>*>& starts){
+    const std::size_t chunks = starts.size();
+    ccNode<T>* head = list.begin();
+    for(std::size_t i = 0; i != chunks; ++i){
+        starts[i] = head + ccChunkBegin(list.size(), chunks, i);
+    }
+}
+
+template<typename T, typename A>
+typename ccList<T, A>::iterator ccIter(const ccList<T, A>&, ccNode<T>* node, std::size_t){
+    return typename ccList<T, A>::iterator(node);
+}
+
+template<typename T, std::size_t K, typename A>
+typename ccIdxList<T, K, A>::iterator ccIter(const ccIdxList<T, K, A>& list,
+                                            ccNode<T>*, std::size_t offset){
+    return typename ccIdxList<T, K, A>::iterator(list, offset);
+}
+
+// Run job(chunk, first node, offset, length) for each chunk and
+// rethrow the exception of the earliest failed chunk, if any
+template<typename T, typename L, typename J>
+void ccRun(const L& list, std::size_t chunks, J& job){
+    std::vector<ccNode<T>*> starts(chunks);
+    ccSplit(list, starts);
+
+    std::vector<std::exception_ptr> errors(chunks);
+    std::vector<std::thread> workers;
+    workers.reserve(chunks - 1);
+    auto run = [&](std::size_t i){
+        const std::size_t offset = ccChunkBegin(list.size(), chunks, i);
+        const std::size_t length = ccChunkBegin(list.size(), chunks, i + 1) - offset;
+        try{
+            job(i, starts[i], offset, length);
+        }catch(...){
+            errors[i] = std::current_exception();
+        }
+    };
+    try{
+        for(std::size_t i = 1; i < chunks; ++i){
+            workers.emplace_back(run, i);
+        }
+    }catch(...){
+        // Joinable threads must not be destroyed
+        for(auto& worker: workers){
+            worker.join();
+        }
+        throw;
+    }
+    run(0);
+    for(auto& worker: workers){
+        worker.join();
+    }
+    for(auto& error: errors){
+        if(error){
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+} // namespace detail
+
+// Apply f to every element
+template<typename L, typename F>
+void par_for_each(const L& list, F f, std::size_t threads = 0){
+    using T = typename L::value_type;
+    if(list.size() == 0){
+        return;
+    }
+    auto job = [&](std::size_t, ccNode<T>* node, std::size_t, std::size_t length){
+        for(; length != 0; --length){
+            f(node->get());
+            node = node->next();
+        }
+    };
+    detail::ccRun<T>(list, detail::ccChunks(list.size(), threads), job);
+}
+
+// Reduce transform(element) over the list with reduce, starting from init.
+// Each chunk is reduced in sequence order and the partial results are then
+// combined in chunk order, so the result does not depend on scheduling.
+template<typename L, typename R, typename B, typename U>
+R par_transform_reduce(const L& list, R init, B reduce, U transform, std::size_t threads = 0){
+    using T = typename L::value_type;
+    if(list.size() == 0){
+        return init;
+    }
+    const std::size_t chunks = detail::ccChunks(list.size(), threads);
+    std::vector<R> partials(chunks, init);
+    auto job = [&](std::size_t i, ccNode<T>* node, std::size_t, std::size_t length){
+        R acc = transform(node->get());
+        while(--length != 0){
+            node = node->next();
+            acc = reduce(std::move(acc), transform(node->get()));
+        }
+        partials[i] = std::move(acc);
+    };
+    detail::ccRun<T>(list, chunks, job);
+    for(auto& partial: partials){
+        init = reduce(std::move(init), std::move(partial));
+    }
+    return init;
+}
+
+// Find the first element, in sequence order, satisfying pred.
+// Returns a default constructed iterator if there is none.
+// Chunks stop early once an earlier match has been found.
+template<typename L, typename P>
+typename L::iterator par_find_if(const L& list, P pred, std::size_t threads = 0){
+    using T = typename L::value_type;
+    if(list.size() == 0){
+        return typename L::iterator();
+    }
+    const std::size_t size = list.size();
+    const std::size_t chunks = detail::ccChunks(size, threads);
+    // Lowest matched offset so far, lets later chunks give up early
+    std::atomic<std::size_t> found(size);
+    std::vector<ccNode<T>*> matches(chunks, nullptr);
+    std::vector<std::size_t> offsets(chunks);
+    auto job = [&](std::size_t i, ccNode<T>* node, std::size_t offset, std::size_t length){
+        for(std::size_t end = offset + length; offset != end; ++offset){
+            if(offset > found.load(std::memory_order_relaxed)){
+                return;
+            }
+            if(pred(node->get())){
+                matches[i] = node;
+                offsets[i] = offset;
+                std::size_t prev = found.load(std::memory_order_relaxed);
+                while(offset < prev && !found.compare_exchange_weak(prev, offset)){
+                }
+                return;
+            }
+            node = node->next();
+        }
+    };
+    detail::ccRun<T>(list, chunks, job);
+    for(std::size_t i = 0; i != chunks; ++i){
+        if(matches[i] != nullptr){
+            return detail::ccIter(list, matches[i], offsets[i]);
+        }
+    }
+    return typename L::iterator();
+}
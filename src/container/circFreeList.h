@@ -0,0 +1,91 @@
+/*
+* Copyright (c) 2021 SdtElectronics . All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 
+* 2. Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+* 
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from this
+*    software without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace detail{
+
+// Lock-free stack of free slots, shared by the pools of fixed slot arrays.
+// Slots are named by index + 1, 0 means none, and each slot stores the
+// name of the one below it; the stack only sees them through the link
+// callables. The head packs the name of the top slot in the low half with
+// a tag bumped on every change in the high half, so a slot popped and
+// pushed back in between cannot fool a stale compare-and-swap (ABA).
+// A slot popped by one thread may still have its link read by another
+// that loaded the old head, so links must be accessed atomically.
+class ccFreeStack{
+  public:
+    // top: name of the top slot of an already linked stack, 0 if empty
+    ccFreeStack(std::uint32_t top = 0);
+
+    // Pop the top slot and return its name, 0 if there is none.
+    // next(name) returns the name of the slot below it
+    template<typename N>
+    std::uint32_t pop(N next);
+    // Push the chain of slots from first to last, which are linked to each
+    // other already. link(name) links last to the slot below it
+    template<typename L>
+    void push(std::uint32_t first, L link);
+
+  private:
+    std::atomic<std::uint64_t> head;
+};
+
+inline ccFreeStack::ccFreeStack(std::uint32_t top): head(top){
+}
+
+template<typename N>
+std::uint32_t ccFreeStack::pop(N next){
+    std::uint64_t old = head.load(std::memory_order_acquire);
+    for(;;){
+        const std::uint32_t top = static_cast<std::uint32_t>(old);
+        if(top == 0){
+            return 0;
+        }
+        const std::uint64_t tagged = ((old >> 32) + 1) << 32 | next(top);
+        if(head.compare_exchange_weak(old, tagged, std::memory_order_acquire)){
+            return top;
+        }
+    }
+}
+
+template<typename L>
+void ccFreeStack::push(std::uint32_t first, L link){
+    std::uint64_t old = head.load(std::memory_order_relaxed);
+    do{
+        link(static_cast<std::uint32_t>(old));
+    }while(!head.compare_exchange_weak(old, ((old >> 32) + 1) << 32 | first,
+                                       std::memory_order_release));
+}
+
+} // namespace detail
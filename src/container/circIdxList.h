@@ -0,0 +1,221 @@
+/*
+* Copyright (c) 2021 SdtElectronics . All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from this
+*    software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "circList.h"
+
+// ccList with a skip index: a pointer to every K-th node is sampled
+// so that seeking to an offset walks at most K - 1 nodes.
+// Plain ccList carries no index, so only users of this type pay for it.
+// ccList is a private base, so that its mutators cannot bypass the index.
+template<typename T, std::size_t K = 64, typename A = std::allocator<T> >
+class ccIdxList: private ccList<T, A>{
+    static_assert(K != 0, "Sampling interval K must be positive");
+
+    using ccList<T, A>::head;
+    using ccList<T, A>::tail;
+    using ccList<T, A>::_size;
+
+  public:
+    using allocator_type  = typename ccList<T, A>::allocator_type;
+    using value_type      = typename ccList<T, A>::value_type;
+    using reference       = typename ccList<T, A>::reference;
+    using const_reference = typename ccList<T, A>::const_reference;
+    using difference_type = typename ccList<T, A>::difference_type;
+    using size_type       = typename ccList<T, A>::size_type;
+
+    using ccList<T, A>::front;
+    using ccList<T, A>::back;
+    using ccList<T, A>::size;
+
+    class iterator{
+      public:
+        using difference_type   = typename A::difference_type;
+        using value_type        = typename A::value_type;
+        using reference         = typename A::reference;
+        using pointer           = typename A::pointer;
+        using iterator_category = std::forward_iterator_tag;
+
+        iterator();
+        iterator(const ccIdxList<T, K, A>& list);
+        // O(K): start from the nearest sampled node before offset
+        iterator(const ccIdxList<T, K, A>& list, std::size_t offset);
+
+        iterator&   operator++  ();
+        iterator    operator++  (int);
+        T&          operator*   () const;
+                    operator ccNode<T>*     () const;
+        bool        operator==  (const iterator& other) const;
+        bool        operator!=  (const iterator& other) const;
+
+        // Move n nodes forward (wrapping around), walks at most K - 1 nodes
+        iterator&   advance     (std::size_t n);
+        // Number of forward steps from this iterator to other, O(1)
+        std::size_t distance    (const iterator& other) const;
+        // Offset of the pointed node from the head of the list
+        inline std::size_t position() const;
+
+      private:
+        const ccIdxList<T, K, A>* list;
+        ccNode<T>* ccNodePtr;
+        std::size_t pos;
+    };
+
+    ccIdxList();
+
+    void push_back(const T& data);
+
+    inline iterator begin() const;
+    inline iterator end() const;
+
+  private:
+    // Node pointer at pos * K for each pos
+    std::vector<ccNode<T>*, typename std::allocator_traits<A>::template
+                            rebind_alloc<ccNode<T>*> > samples;
+
+    ccNode<T>* seek(std::size_t offset) const;
+};
+
+template<typename T, std::size_t K, typename A>
+ccIdxList<T, K, A>::ccIdxList(): ccList<T, A>::ccList(){
+}
+
+template<typename T, std::size_t K, typename A>
+void ccIdxList<T, K, A>::push_back(const T& data){
+    ccList<T, A>::push_back(data);
+    if((_size - 1) % K == 0){
+        samples.push_back(tail);
+    }
+}
+
+template<typename T, std::size_t K, typename A>
+ccNode<T>* ccIdxList<T, K, A>::seek(std::size_t offset) const{
+    ccNode<T>* node = samples[offset / K];
+    for(std::size_t i = offset % K; i != 0; --i){
+        node = node->next();
+    }
+    return node;
+}
+
+template<typename T, std::size_t K, typename A>
+typename ccIdxList<T, K, A>::iterator ccIdxList<T, K, A>::begin() const{
+    return iterator(*this);
+}
+
+template<typename T, std::size_t K, typename A>
+typename ccIdxList<T, K, A>::iterator ccIdxList<T, K, A>::end() const{
+    return _size != 0 ? iterator(*this, _size - 1) : iterator(*this);
+}
+
+template<typename T, std::size_t K, typename A>
+ccIdxList<T, K, A>::iterator::iterator(): list(nullptr), ccNodePtr(nullptr), pos(0){
+}
+
+template<typename T, std::size_t K, typename A>
+ccIdxList<T, K, A>::iterator::iterator(const ccIdxList<T, K, A>& list):
+                                        list(&list), ccNodePtr(list.head), pos(0){
+}
+
+template<typename T, std::size_t K, typename A>
+ccIdxList<T, K, A>::iterator::iterator(const ccIdxList<T, K, A>& list, std::size_t offset):
+                                        list(&list), ccNodePtr(list.head), pos(0){
+    // Empty list: the sentinel node, like ccList
+    if(list.size() != 0){
+        pos = offset % list.size();
+        ccNodePtr = list.seek(pos);
+    }
+}
+
+template<typename T, std::size_t K, typename A>
+typename ccIdxList<T, K, A>::iterator& ccIdxList<T, K, A>::iterator::operator++(){
+    ccNodePtr = ccNodePtr->next();
+    pos = (pos + 1 == list->size()) ? 0 : pos + 1;
+    return *this;
+}
+
+template<typename T, std::size_t K, typename A>
+typename ccIdxList<T, K, A>::iterator ccIdxList<T, K, A>::iterator::operator++(int){
+    auto ret = *this;
+    ++(*this);
+    return ret;
+}
+
+template<typename T, std::size_t K, typename A>
+T& ccIdxList<T, K, A>::iterator::operator*() const{
+    return ccNodePtr->get();
+}
+
+template<typename T, std::size_t K, typename A>
+ccIdxList<T, K, A>::iterator::operator ccNode<T>*() const{
+    return ccNodePtr;
+}
+
+template<typename T, std::size_t K, typename A>
+bool ccIdxList<T, K, A>::iterator::operator==(const iterator& other) const{
+    return ccNodePtr == other.ccNodePtr;
+}
+
+template<typename T, std::size_t K, typename A>
+bool ccIdxList<T, K, A>::iterator::operator!=(const iterator& other) const{
+    return ccNodePtr != other.ccNodePtr;
+}
+
+template<typename T, std::size_t K, typename A>
+typename ccIdxList<T, K, A>::iterator& ccIdxList<T, K, A>::iterator::advance(std::size_t n){
+    if(list->size() == 0){
+        return *this;
+    }
+    n %= list->size();
+    std::size_t target = pos + n;
+    target -= target >= list->size() ? list->size() : 0;
+    // Walking from here is cheaper than seeking for short hops
+    if(n <= target % K){
+        for(; n != 0; --n){
+            ccNodePtr = ccNodePtr->next();
+        }
+    }else{
+        ccNodePtr = list->seek(target);
+    }
+    pos = target;
+    return *this;
+}
+
+template<typename T, std::size_t K, typename A>
+std::size_t ccIdxList<T, K, A>::iterator::distance(const iterator& other) const{
+    return other.pos >= pos ? other.pos - pos : list->size() - pos + other.pos;
+}
+
+template<typename T, std::size_t K, typename A>
+std::size_t ccIdxList<T, K, A>::iterator::position() const{
+    return pos;
+}
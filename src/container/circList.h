@@ -46,12 +46,16 @@ class ccNode{
   private:
     template<typename _T, typename A>
     friend class ccList;
+    template<typename _T, typename A>
+    friend class ccPool;
+    template<typename _T, typename A>
+    friend class ccAtomicPool;
     ccNode<T>* _next;
     T _data;
 };
 
 template<typename T>
-ccNode<T>::ccNode(const T& data, ccNode<T>* next): _data(data), _next(next){
+ccNode<T>::ccNode(const T& data, ccNode<T>* next): _next(next), _data(data){
 
 }
 
@@ -155,12 +159,12 @@ ccList<T, A>::~ccList(){
 
 template<typename T, typename A>
 T& ccList<T, A>::front() const{
-    return *head;
+    return head->get();
 }
 
 template<typename T, typename A>
 T& ccList<T, A>::back() const{
-    return *tail;
+    return tail->get();
 }
 
 template<typename T, typename A>
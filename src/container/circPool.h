@@ -0,0 +1,333 @@
+/*
+* Copyright (c) 2021 SdtElectronics . All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 
+* 2. Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+* 
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from this
+*    software without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#include "circBuf.h"
+#include "circFreeList.h"
+
+// Fixed size object pool on the contiguous node block of ccBuf.
+// Free nodes are linked through their next pointers, so checking a slot
+// out or back in relinks one node and never touches the allocator.
+// acquire() constructs the object in place and release() destroys it.
+// Objects still checked out when the pool is destroyed are not destroyed.
+template<typename T, typename A = std::allocator<T> >
+class ccPool: protected ccBuf<T, A>{
+  public:
+    ccPool(size_t size);
+
+    // Construct a T from args in a free slot, nullptr if there is none
+    template<typename... Args>
+    T* acquire(Args&&... args);
+    // Destroy obj and return its slot, obj must come from this pool
+    void release(T* obj);
+
+    // Number of slots
+    inline size_t size() const;
+    // Number of slots checked out, the fill level is used() / size()
+    inline size_t used() const;
+
+  private:
+    using ccList<T, A>::head;
+    using ccList<T, A>::_size;
+
+    // First free node, nullptr if there is none
+    ccNode<T>* spare;
+    size_t inUse;
+};
+
+// ccPool safe to share between threads.
+// The free list is a detail::ccFreeStack of nodes named by index + 1.
+// Threads that acquire and release often should go through a cache, which
+// keeps a few free slots of its own and touches the shared list only once
+// per batch.
+template<typename T, typename A = std::allocator<T> >
+class ccAtomicPool: protected ccBuf<T, A>{
+  public:
+    // Free slots owned by one thread, refilled from and flushed to the
+    // pool in batches of half its size. Must not outlive the pool
+    class cache{
+      public:
+        // size: maximum number of free slots held
+        cache(ccAtomicPool<T, A>& pool, size_t size = 32);
+        // Return every held slot to the pool
+        ~cache();
+
+        // Construct a T from args in a free slot, nullptr if there is none
+        template<typename... Args>
+        T* acquire(Args&&... args);
+        // Destroy obj and keep its slot, obj must come from the same pool
+        void release(T* obj);
+
+      private:
+        ccAtomicPool<T, A>& pool;
+        const size_t capacity;
+        ccNode<T>* spare;
+        size_t count;
+
+        // Return the first n held slots to the pool
+        void flush(size_t n);
+
+        cache(const cache&) = delete;
+        cache& operator = (const cache&) = delete;
+    };
+
+    // size: number of slots, less than 2^32 - 1
+    ccAtomicPool(size_t size);
+
+    // Construct a T from args in a free slot, nullptr if there is none
+    template<typename... Args>
+    T* acquire(Args&&... args);
+    // Destroy obj and return its slot, obj must come from this pool
+    void release(T* obj);
+
+    // Number of slots
+    inline size_t size() const;
+    // Number of slots off the shared free list: objects checked out and
+    // free slots held by caches
+    inline size_t used() const;
+
+  private:
+    using ccList<T, A>::head;
+    using ccList<T, A>::_size;
+
+    detail::ccFreeStack spare;
+    std::atomic<size_t> inUse;
+
+    // Take the first free node, nullptr if there is none
+    ccNode<T>* pop();
+    // Put the chain of n nodes from first to last in front of the free list
+    void push(ccNode<T>* first, ccNode<T>* last, size_t n);
+    inline ccNode<T>* node(T* obj) const;
+    // Index + 1 of node, 0 for nullptr, and back
+    inline std::uint32_t name(ccNode<T>* node) const;
+    inline ccNode<T>* named(std::uint32_t name) const;
+
+    // A node popped by one thread may still be read by another that loaded
+    // the old head, so links are accessed atomically
+    static inline ccNode<T>* linked(ccNode<T>* node);
+    static inline void link(ccNode<T>* node, ccNode<T>* next);
+};
+
+template<typename T, typename A>
+ccPool<T, A>::ccPool(size_t size): ccBuf<T, A>::ccBuf(size),
+                                   spare(size != 0 ? head : nullptr),
+                                   inUse(0){
+    for(size_t i = 0; i != size; ++i){
+        head[i]._next = i + 1 != size ? head + i + 1 : nullptr;
+    }
+}
+
+template<typename T, typename A>
+template<typename... Args>
+T* ccPool<T, A>::acquire(Args&&... args){
+    ccNode<T>* node = spare;
+    if(node == nullptr){
+        return nullptr;
+    }
+    //Unlink only once constructed, a throwing constructor leaves the slot free
+    T* obj = new(&node->_data) T(std::forward<Args>(args)...);
+    spare = node->_next;
+    ++inUse;
+    return obj;
+}
+
+template<typename T, typename A>
+void ccPool<T, A>::release(T* obj){
+    //Slots are sizeof(ccNode<T>) apart, starting from the data of head
+    ccNode<T>* node = head + (reinterpret_cast<char*>(obj) -
+                              reinterpret_cast<char*>(&head->_data)) / sizeof(ccNode<T>);
+    obj->~T();
+    node->_next = spare;
+    spare = node;
+    --inUse;
+}
+
+template<typename T, typename A>
+size_t ccPool<T, A>::size() const{
+    return _size;
+}
+
+template<typename T, typename A>
+size_t ccPool<T, A>::used() const{
+    return inUse;
+}
+
+template<typename T, typename A>
+ccAtomicPool<T, A>::ccAtomicPool(size_t size): ccBuf<T, A>::ccBuf(size),
+                                               spare(size != 0 ? 1 : 0),
+                                               inUse(0){
+    if(size >= UINT32_MAX){
+        throw std::length_error("ccAtomicPool: too many slots");
+    }
+    for(size_t i = 0; i != size; ++i){
+        link(head + i, i + 1 != size ? head + i + 1 : nullptr);
+    }
+}
+
+template<typename T, typename A>
+ccNode<T>* ccAtomicPool<T, A>::linked(ccNode<T>* node){
+    return __atomic_load_n(&node->_next, __ATOMIC_RELAXED);
+}
+
+template<typename T, typename A>
+void ccAtomicPool<T, A>::link(ccNode<T>* node, ccNode<T>* next){
+    __atomic_store_n(&node->_next, next, __ATOMIC_RELAXED);
+}
+
+template<typename T, typename A>
+ccNode<T>* ccAtomicPool<T, A>::node(T* obj) const{
+    return head + (reinterpret_cast<char*>(obj) -
+                   reinterpret_cast<char*>(&head->_data)) / sizeof(ccNode<T>);
+}
+
+template<typename T, typename A>
+std::uint32_t ccAtomicPool<T, A>::name(ccNode<T>* node) const{
+    return node != nullptr ? static_cast<std::uint32_t>(node - head + 1) : 0;
+}
+
+template<typename T, typename A>
+ccNode<T>* ccAtomicPool<T, A>::named(std::uint32_t name) const{
+    return name != 0 ? head + (name - 1) : nullptr;
+}
+
+template<typename T, typename A>
+ccNode<T>* ccAtomicPool<T, A>::pop(){
+    return named(spare.pop([this](std::uint32_t top){
+        return name(linked(named(top)));
+    }));
+}
+
+template<typename T, typename A>
+void ccAtomicPool<T, A>::push(ccNode<T>* first, ccNode<T>* last, size_t n){
+    inUse.fetch_sub(n, std::memory_order_relaxed);
+    spare.push(name(first), [this, last](std::uint32_t below){
+        link(last, named(below));
+    });
+}
+
+template<typename T, typename A>
+template<typename... Args>
+T* ccAtomicPool<T, A>::acquire(Args&&... args){
+    ccNode<T>* node = pop();
+    if(node == nullptr){
+        return nullptr;
+    }
+    inUse.fetch_add(1, std::memory_order_relaxed);
+    try{
+        return new(&node->_data) T(std::forward<Args>(args)...);
+    }catch(...){
+        push(node, node, 1);
+        throw;
+    }
+}
+
+template<typename T, typename A>
+void ccAtomicPool<T, A>::release(T* obj){
+    ccNode<T>* slot = node(obj);
+    obj->~T();
+    push(slot, slot, 1);
+}
+
+template<typename T, typename A>
+size_t ccAtomicPool<T, A>::size() const{
+    return _size;
+}
+
+template<typename T, typename A>
+size_t ccAtomicPool<T, A>::used() const{
+    return inUse.load(std::memory_order_relaxed);
+}
+
+template<typename T, typename A>
+ccAtomicPool<T, A>::cache::cache(ccAtomicPool<T, A>& pool, size_t size):
+    pool(pool), capacity(size != 0 ? size : 1), spare(nullptr), count(0){
+}
+
+template<typename T, typename A>
+ccAtomicPool<T, A>::cache::~cache(){
+    flush(count);
+}
+
+template<typename T, typename A>
+template<typename... Args>
+T* ccAtomicPool<T, A>::cache::acquire(Args&&... args){
+    if(spare == nullptr){
+        //Refill half way, so that alternating acquire and release on the
+        //boundary does not hit the shared list every time
+        const size_t batch = capacity / 2 != 0 ? capacity / 2 : 1;
+        ccNode<T>* node;
+        while(count != batch && (node = pool.pop()) != nullptr){
+            link(node, spare);
+            spare = node;
+            ++count;
+        }
+        if(spare == nullptr){
+            return nullptr;
+        }
+        pool.inUse.fetch_add(count, std::memory_order_relaxed);
+    }
+    ccNode<T>* node = spare;
+    T* obj = new(&node->_data) T(std::forward<Args>(args)...);
+    spare = linked(node);
+    --count;
+    return obj;
+}
+
+template<typename T, typename A>
+void ccAtomicPool<T, A>::cache::release(T* obj){
+    ccNode<T>* node = pool.node(obj);
+    obj->~T();
+    link(node, spare);
+    spare = node;
+    if(++count > capacity){
+        flush(count - capacity / 2);
+    }
+}
+
+template<typename T, typename A>
+void ccAtomicPool<T, A>::cache::flush(size_t n){
+    if(n == 0){
+        return;
+    }
+    ccNode<T>* first = spare;
+    ccNode<T>* last = first;
+    for(size_t i = 1; i != n; ++i){
+        last = linked(last);
+    }
+    spare = linked(last);
+    count -= n;
+    pool.push(first, last, n);
+}
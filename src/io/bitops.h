@@ -0,0 +1,170 @@
+/*
+* Copyright (c) 2021 SdtElectronics . All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 
+* 2. Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+* 
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from this
+*    software without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Order in which the bits of a stream are laid out in each byte.
+// lsb: the first bit of the stream is the lowest bit of a byte,
+//      multi-bit fields start from their least significant bit (DEFLATE).
+// msb: the first bit of the stream is the highest bit of a byte,
+//      multi-bit fields start from their most significant bit (network order).
+enum class bitorder{lsb, msb};
+
+// Kernels for x86 extensions are compiled with target attributes and
+// selected at run time, see bccpu()
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BCIO_X86 1
+#endif
+
+namespace detail{
+
+// Extensions of the running CPU used by the kernel dispatchers
+struct bcisa{
+    bool sse2;
+    bool popcnt;
+    bool avx2;
+};
+
+// Probed once and shared by every dispatcher
+inline const bcisa& bccpu(){
+    static const bcisa probed = []{
+        bcisa isa{false, false, false};
+#ifdef BCIO_X86
+        __builtin_cpu_init();
+        isa.sse2 = __builtin_cpu_supports("sse2");
+        isa.popcnt = __builtin_cpu_supports("popcnt");
+        isa.avx2 = __builtin_cpu_supports("avx2");
+#endif
+        return isa;
+    }();
+    return probed;
+}
+
+inline std::uint64_t bcbswap64(std::uint64_t w){
+#if defined(__GNUC__)
+    return __builtin_bswap64(w);
+#else
+    w = ((w & 0x00ff00ff00ff00ffull) << 8)  | ((w >> 8)  & 0x00ff00ff00ff00ffull);
+    w = ((w & 0x0000ffff0000ffffull) << 16) | ((w >> 16) & 0x0000ffff0000ffffull);
+    return (w << 32) | (w >> 32);
+#endif
+}
+
+inline bool bcbigendian(){
+#if defined(__BYTE_ORDER__)
+    return __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__;
+#else
+    const std::uint16_t probe = 1;
+    std::uint8_t first;
+    std::memcpy(&first, &probe, 1);
+    return first == 0;
+#endif
+}
+
+// Load and store 8 unaligned bytes as little or big endian words
+inline std::uint64_t bcloadle(const std::uint8_t* src){
+    std::uint64_t w;
+    std::memcpy(&w, src, 8);
+    return bcbigendian() ? bcbswap64(w) : w;
+}
+
+inline std::uint64_t bcloadbe(const std::uint8_t* src){
+    std::uint64_t w;
+    std::memcpy(&w, src, 8);
+    return bcbigendian() ? w : bcbswap64(w);
+}
+
+inline void bcstorele(std::uint8_t* dst, std::uint64_t w){
+    w = bcbigendian() ? bcbswap64(w) : w;
+    std::memcpy(dst, &w, 8);
+}
+
+inline void bcstorebe(std::uint8_t* dst, std::uint64_t w){
+    w = bcbigendian() ? w : bcbswap64(w);
+    std::memcpy(dst, &w, 8);
+}
+
+// Lowest n bits set, n in [1, 64]
+inline std::uint64_t bcmask(unsigned n){
+    return ~std::uint64_t(0) >> (64 - n);
+}
+
+// Lowest n bits (1-64) of v in reverse order
+inline std::uint64_t bcreverse(std::uint64_t v, unsigned n){
+    v = ((v >> 1) & 0x5555555555555555ull) | ((v & 0x5555555555555555ull) << 1);
+    v = ((v >> 2) & 0x3333333333333333ull) | ((v & 0x3333333333333333ull) << 2);
+    v = ((v >> 4) & 0x0f0f0f0f0f0f0f0full) | ((v & 0x0f0f0f0f0f0f0f0full) << 4);
+    return bcbswap64(v) >> (64 - n);
+}
+
+// Number of set bits. Build with -mpopcnt (or -march) to get the
+// instruction instead of a library call, or go through bccpu() dispatched
+// kernels such as those of bitrank.h
+inline unsigned bcpopcount64(std::uint64_t w){
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_popcountll(w));
+#else
+    w = w - ((w >> 1) & 0x5555555555555555ull);
+    w = (w & 0x3333333333333333ull) + ((w >> 2) & 0x3333333333333333ull);
+    w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return static_cast<unsigned>((w * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// Count of leading and trailing zero bits, w must not be 0
+inline unsigned bcclz64(std::uint64_t w){
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_clzll(w));
+#else
+    unsigned n = 0;
+    for(; !(w & (std::uint64_t(1) << 63)); w <<= 1){
+        ++n;
+    }
+    return n;
+#endif
+}
+
+inline unsigned bcctz64(std::uint64_t w){
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctzll(w));
+#else
+    unsigned n = 0;
+    for(; !(w & 1u); w >>= 1){
+        ++n;
+    }
+    return n;
+#endif
+}
+
+} // namespace detail
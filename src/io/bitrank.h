@@ -0,0 +1,394 @@
+/*
+* Copyright (c) 2021 SdtElectronics . All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 
+* 2. Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+* 
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from this
+*    software without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "bitops.h"
+
+#ifdef BCIO_X86
+#include <immintrin.h>
+#endif
+
+namespace detail{
+
+using bcones_fn = unsigned (*)(std::uint64_t w);
+using bccount_fn = std::size_t (*)(const std::uint8_t* src, std::size_t size);
+using bclogic_fn = void (*)(std::uint8_t* dst, const std::uint8_t* a,
+                            const std::uint8_t* b, std::size_t size);
+
+inline unsigned bcones_swar(std::uint64_t w){
+    return bcpopcount64(w);
+}
+
+inline std::size_t bccount_swar(const std::uint8_t* src, std::size_t size){
+    std::size_t n = 0;
+    std::size_t i = 0;
+    for(; i + 8 <= size; i += 8){
+        n += bcpopcount64(bcloadle(src + i));
+    }
+    for(; i != size; ++i){
+        n += bcpopcount64(src[i]);
+    }
+    return n;
+}
+
+inline void bcand_swar(std::uint8_t* dst, const std::uint8_t* a,
+                       const std::uint8_t* b, std::size_t size){
+    for(std::size_t i = 0; i != size; ++i){
+        dst[i] = a[i] & b[i];
+    }
+}
+
+inline void bcor_swar(std::uint8_t* dst, const std::uint8_t* a,
+                      const std::uint8_t* b, std::size_t size){
+    for(std::size_t i = 0; i != size; ++i){
+        dst[i] = a[i] | b[i];
+    }
+}
+
+#ifdef BCIO_X86
+__attribute__((target("popcnt")))
+inline unsigned bcones_popcnt(std::uint64_t w){
+    return static_cast<unsigned>(__builtin_popcountll(w));
+}
+
+__attribute__((target("popcnt")))
+inline std::size_t bccount_popcnt(const std::uint8_t* src, std::size_t size){
+    std::size_t n = 0;
+    std::size_t i = 0;
+    for(; i + 8 <= size; i += 8){
+        std::uint64_t w;
+        std::memcpy(&w, src + i, 8);
+        n += static_cast<std::size_t>(__builtin_popcountll(w));
+    }
+    for(; i != size; ++i){
+        n += static_cast<std::size_t>(__builtin_popcount(src[i]));
+    }
+    return n;
+}
+
+// Nibble lookup with pshufb, summed per 8 bytes with psadbw
+__attribute__((target("avx2,popcnt")))
+inline std::size_t bccount_avx2(const std::uint8_t* src, std::size_t size){
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i acc = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for(; i + 32 <= size; i += 32){
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i lo = _mm256_and_si256(v, low);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+        __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo),
+                                      _mm256_shuffle_epi8(lut, hi));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
+    }
+    std::uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + bccount_popcnt(src + i, size - i);
+}
+
+__attribute__((target("sse2")))
+inline void bcand_sse2(std::uint8_t* dst, const std::uint8_t* a,
+                       const std::uint8_t* b, std::size_t size){
+    std::size_t i = 0;
+    for(; i + 16 <= size; i += 16){
+        __m128i v = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                  _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+    bcand_swar(dst + i, a + i, b + i, size - i);
+}
+
+__attribute__((target("sse2")))
+inline void bcor_sse2(std::uint8_t* dst, const std::uint8_t* a,
+                      const std::uint8_t* b, std::size_t size){
+    std::size_t i = 0;
+    for(; i + 16 <= size; i += 16){
+        __m128i v = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+    bcor_swar(dst + i, a + i, b + i, size - i);
+}
+
+__attribute__((target("avx2")))
+inline void bcand_avx2(std::uint8_t* dst, const std::uint8_t* a,
+                       const std::uint8_t* b, std::size_t size){
+    std::size_t i = 0;
+    for(; i + 32 <= size; i += 32){
+        __m256i v = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                     _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+    bcand_sse2(dst + i, a + i, b + i, size - i);
+}
+
+__attribute__((target("avx2")))
+inline void bcor_avx2(std::uint8_t* dst, const std::uint8_t* a,
+                      const std::uint8_t* b, std::size_t size){
+    std::size_t i = 0;
+    for(; i + 32 <= size; i += 32){
+        __m256i v = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+    bcor_sse2(dst + i, a + i, b + i, size - i);
+}
+#endif
+
+struct bcbulk{
+    bcones_fn ones;
+    bccount_fn count;
+    bclogic_fn conj;
+    bclogic_fn disj;
+};
+
+// Kernels for the running CPU, selected once
+inline const bcbulk& bcbulker(){
+    static const bcbulk selected = []{
+#ifdef BCIO_X86
+        const bcisa& cpu = bccpu();
+        if(cpu.avx2 && cpu.popcnt){
+            return bcbulk{bcones_popcnt, bccount_avx2, bcand_avx2, bcor_avx2};
+        }
+        if(cpu.popcnt){
+            return bcbulk{bcones_popcnt, bccount_popcnt, bcand_sse2, bcor_sse2};
+        }
+        if(cpu.sse2){
+            return bcbulk{bcones_swar, bccount_swar, bcand_sse2, bcor_sse2};
+        }
+#endif
+        return bcbulk{bcones_swar, bccount_swar, bcand_swar, bcor_swar};
+    }();
+    return selected;
+}
+
+// Position of the r-th (from 0) set bit of w counting from bit 0
+inline unsigned bcselect64(std::uint64_t w, unsigned r){
+    // Running byte counts, byte j holds the set bits of bytes 0 to j
+    std::uint64_t c = w - ((w >> 1) & 0x5555555555555555ull);
+    c = (c & 0x3333333333333333ull) + ((c >> 2) & 0x3333333333333333ull);
+    c = ((c + (c >> 4)) & 0x0f0f0f0f0f0f0f0full) * 0x0101010101010101ull;
+    unsigned byte = 0;
+    while(((c >> (8 * byte)) & 0xffu) <= r){
+        ++byte;
+    }
+    r -= byte ? static_cast<unsigned>((c >> (8 * (byte - 1))) & 0xffu) : 0;
+    unsigned bits = static_cast<unsigned>((w >> (8 * byte)) & 0xffu);
+    for(; r != 0; --r){
+        bits &= bits - 1;
+    }
+    return 8 * byte + bcctz64(bits);
+}
+
+} // namespace detail
+
+// Number of set bits in size bytes from data
+inline std::size_t bcpopcount(const std::uint8_t* data, std::size_t size){
+    return detail::bcbulker().count(data, size);
+}
+
+// dst = a & b over size bytes, dst may be a or b
+inline void bcand(std::uint8_t* dst, const std::uint8_t* a,
+                  const std::uint8_t* b, std::size_t size){
+    detail::bcbulker().conj(dst, a, b, size);
+}
+
+// dst = a | b over size bytes, dst may be a or b
+inline void bcor(std::uint8_t* dst, const std::uint8_t* a,
+                 const std::uint8_t* b, std::size_t size){
+    detail::bcbulker().disj(dst, a, b, size);
+}
+
+// Rank/select index over a bit array in place, e.g. data() of a finished
+// bcbuf with the same bit order O. The array must outlive the index.
+// Superblocks of 4096 bits keep absolute counts and blocks of 512 bits keep
+// counts relative to their superblock, so rank takes at most 8 popcounts.
+// The block of every 8192nd set bit is sampled to narrow select down to a
+// binary search over few blocks. About 5% space overhead.
+template <bitorder O = bitorder::lsb>
+class bcrank{
+  public:
+    // nbits: length of data in bits
+    bcrank(const std::uint8_t* data, std::size_t nbits);
+
+    // Number of set bits in [0, i), i <= size()
+    inline std::size_t rank(std::size_t i) const;
+    // Position of the k-th set bit counting from 0, size() if k >= ones()
+    inline std::size_t select(std::size_t k) const;
+    inline bool test(std::size_t i) const;
+
+    inline std::size_t ones() const;
+    inline std::size_t size() const;
+
+  private:
+    static constexpr std::size_t blockWords = 8;
+    static constexpr std::size_t superWords = 64;
+    static constexpr std::size_t sampleRate = 8192;
+
+    const std::uint8_t* buf;
+    // Popcount kernels for the running CPU
+    const detail::bcbulk* kernels;
+    std::size_t nbits;
+    std::size_t nwords;
+    std::size_t total;
+    // Last word with bits past the end cleared
+    std::uint64_t last;
+    std::vector<std::uint64_t> supers;
+    std::vector<std::uint16_t> blocks;
+    std::vector<std::uint32_t> samples;
+
+    // Word j with stream bit 64j + t at bit t
+    inline std::uint64_t word(std::size_t j) const;
+    // Set bits before block b
+    inline std::size_t before(std::size_t b) const;
+};
+
+template <bitorder O>
+bcrank<O>::bcrank(const std::uint8_t* data, std::size_t nbits):
+    buf(data), kernels(&detail::bcbulker()), nbits(nbits), nwords((nbits + 63) / 64),
+    total(0), last(0){
+    if(nwords != 0){
+        std::uint8_t tmp[8] = {};
+        std::memcpy(tmp, buf + (nwords - 1) * 8, (nbits + 7) / 8 - (nwords - 1) * 8);
+        last = O == bitorder::lsb ? detail::bcloadle(tmp)
+                                  : detail::bcreverse(detail::bcloadbe(tmp), 64);
+        if(nbits % 64){
+            last &= detail::bcmask(nbits % 64);
+        }
+    }
+    const std::size_t nblocks = (nwords + blockWords - 1) / blockWords;
+    supers.reserve((nwords + superWords - 1) / superWords + 1);
+    blocks.reserve(nblocks + 1);
+    std::size_t inSuper = 0;
+    for(std::size_t b = 0; b != nblocks; ++b){
+        if(b % (superWords / blockWords) == 0){
+            supers.push_back(total);
+            inSuper = 0;
+        }
+        blocks.push_back(static_cast<std::uint16_t>(inSuper));
+        std::size_t end = (b + 1) * blockWords < nwords ? (b + 1) * blockWords : nwords;
+        for(std::size_t j = b * blockWords; j != end; ++j){
+            std::size_t ones = kernels->ones(word(j));
+            // Sample the block holding every sampleRate-th set bit
+            while(samples.size() * sampleRate < total + ones){
+                samples.push_back(static_cast<std::uint32_t>(b));
+            }
+            total += ones;
+            inSuper += ones;
+        }
+    }
+    // Sentinel past the last block
+    if(nblocks % (superWords / blockWords) == 0){
+        supers.push_back(total);
+        inSuper = 0;
+    }
+    blocks.push_back(static_cast<std::uint16_t>(inSuper));
+    samples.push_back(static_cast<std::uint32_t>(nblocks));
+}
+
+template <bitorder O>
+std::uint64_t bcrank<O>::word(std::size_t j) const{
+    if(j + 1 == nwords){
+        return last;
+    }
+    return O == bitorder::lsb ? detail::bcloadle(buf + j * 8)
+                              : detail::bcreverse(detail::bcloadbe(buf + j * 8), 64);
+}
+
+template <bitorder O>
+std::size_t bcrank<O>::before(std::size_t b) const{
+    return supers[b / (superWords / blockWords)] + blocks[b];
+}
+
+template <bitorder O>
+std::size_t bcrank<O>::rank(std::size_t i) const{
+    const std::size_t w = i / 64;
+    const std::size_t first = w / blockWords * blockWords;
+    std::size_t n = before(w / blockWords);
+    // Whole words before w are never the last one, and byte order does not
+    // change their counts, so they are counted straight from buf
+    if(w != first){
+        n += kernels->count(buf + first * 8, (w - first) * 8);
+    }
+    if(i % 64){
+        n += kernels->ones(word(w) & detail::bcmask(i % 64));
+    }
+    return n;
+}
+
+template <bitorder O>
+std::size_t bcrank<O>::select(std::size_t k) const{
+    if(k >= total){
+        return nbits;
+    }
+    // Last block in the sampled range with fewer than k + 1 set bits before it
+    std::size_t lo = samples[k / sampleRate];
+    std::size_t hi = samples[k / sampleRate + 1];
+    while(lo < hi){
+        std::size_t mid = lo + (hi - lo + 1) / 2;
+        if(before(mid) <= k){
+            lo = mid;
+        }else{
+            hi = mid - 1;
+        }
+    }
+    std::size_t r = k - before(lo);
+    std::size_t j = lo * blockWords;
+    for(;; ++j){
+        std::uint64_t w = word(j);
+        std::size_t ones = kernels->ones(w);
+        if(r < ones){
+            return j * 64 + detail::bcselect64(w, static_cast<unsigned>(r));
+        }
+        r -= ones;
+    }
+}
+
+template <bitorder O>
+bool bcrank<O>::test(std::size_t i) const{
+    return (word(i / 64) >> (i % 64)) & 1u;
+}
+
+template <bitorder O>
+std::size_t bcrank<O>::ones() const{
+    return total;
+}
+
+template <bitorder O>
+std::size_t bcrank<O>::size() const{
+    return nbits;
+}
@@ -0,0 +1,340 @@
+/*
+* Copyright (c) 2021 SdtElectronics . All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 
+* 2. Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+* 
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from this
+*    software without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "bitops.h"
+
+// Entropy coders writing through bcbuf or bcstream and reading through
+// bcreader. Codes are defined as bit sequences in stream order, so the
+// output of either bit order decodes with a reader of the same order.
+// Every code is emitted with a single multi-bit write where it fits in
+// 64 bits. Decoding corrupted input yields unspecified values.
+
+namespace detail{
+
+// Write an MSB-first code of len (1-64) bits in stream order
+template <typename W>
+inline void bcput(W& w, std::uint64_t code, unsigned len){
+    w.write(W::order == bitorder::msb ? code : bcreverse(code, len), len);
+}
+
+// Read an MSB-first code of len (1-64) bits in stream order
+template <typename R>
+inline std::uint64_t bcget(R& r, unsigned len){
+    std::uint64_t code = r.read(len);
+    return R::order == bitorder::msb ? code : bcreverse(code, len);
+}
+
+template <typename W>
+inline void bczeros(W& w, std::size_t n){
+    for(; n > 64; n -= 64){
+        w.write(0, 64);
+    }
+    if(n != 0){
+        w.write(0, static_cast<unsigned>(n));
+    }
+}
+
+// Count and consume the zero bits before the next set bit
+template <typename R>
+inline std::uint64_t bcskipzeros(R& r){
+    std::uint64_t zeros = 0;
+    while(true){
+        std::uint64_t w = r.peek(64);
+        if(w != 0){
+            unsigned n = R::order == bitorder::msb ? bcclz64(w) : bcctz64(w);
+            r.skip(n);
+            return zeros + n;
+        }
+        r.skip(64);
+        zeros += 64;
+        if(r.left() == 0){
+            return zeros;
+        }
+    }
+}
+
+} // namespace detail
+
+// Exp-Golomb code of v (ue(v) in H.264)
+template <typename W>
+inline void writeUE(W& w, std::uint64_t v){
+    const std::uint64_t x = v + 1;
+    if(x == 0){
+        // v + 1 = 2^64: 64 zeros, the set bit and 64 more zeros
+        detail::bczeros(w, 64);
+        detail::bcput(w, 1, 1);
+        detail::bczeros(w, 64);
+        return;
+    }
+    const unsigned n = 64 - detail::bcclz64(x);
+    if(n <= 32){
+        // n - 1 leading zeros are the high bits of a 2n - 1 bit field
+        detail::bcput(w, x, 2 * n - 1);
+    }else{
+        detail::bczeros(w, n - 1);
+        detail::bcput(w, x, n);
+    }
+}
+
+template <typename R>
+inline std::uint64_t readUE(R& r){
+    const std::uint64_t zeros = detail::bcskipzeros(r);
+    if(zeros >= 64){
+        detail::bcget(r, 1);
+        return detail::bcget(r, 64) - 1;
+    }
+    return detail::bcget(r, static_cast<unsigned>(zeros) + 1) - 1;
+}
+
+// Signed Exp-Golomb code of v (se(v) in H.264), 1 -1 2 -2 ... map to 1 2 3 4 ...
+// This is the zigzag mapping of -v, done on uint64_t so that INT64_MIN
+// maps to 2^64 - 1 without overflow
+template <typename W>
+inline void writeSE(W& w, std::int64_t v){
+    const std::uint64_t n = 0 - static_cast<std::uint64_t>(v);
+    writeUE(w, (n << 1) ^ (0 - (n >> 63)));
+}
+
+template <typename R>
+inline std::int64_t readSE(R& r){
+    const std::uint64_t u = readUE(r);
+    const std::uint64_t n = (u >> 1) ^ (0 - (u & 1u));
+    return static_cast<std::int64_t>(0 - n);
+}
+
+// Golomb-Rice code of v with parameter k (0-63):
+// v >> k zero bits, a set bit, then the lowest k bits of v
+template <typename W>
+inline void writeRice(W& w, std::uint64_t v, unsigned k){
+    const std::uint64_t q = v >> k;
+    const std::uint64_t code = (std::uint64_t(1) << k) | (k ? v & detail::bcmask(k) : 0);
+    if(q + k < 64){
+        detail::bcput(w, code, static_cast<unsigned>(q + k + 1));
+    }else{
+        detail::bczeros(w, q);
+        detail::bcput(w, code, k + 1);
+    }
+}
+
+template <typename R>
+inline std::uint64_t readRice(R& r, unsigned k){
+    const std::uint64_t q = detail::bcskipzeros(r);
+    const std::uint64_t code = detail::bcget(r, k + 1);
+    return (q << k) | (code ^ (std::uint64_t(1) << k));
+}
+
+// Canonical Huffman code limited to M bits per code.
+// Decoding looks up the next M bits in a table of 2^M entries.
+// O: bit order of the streams the code is used with
+template <bitorder O, unsigned M = 12>
+class huffman{
+    static_assert(M >= 1 && M <= 16, "Code length limit must be within 1-16");
+
+  public:
+    // Build from freq[symbol], symbols of zero frequency get no code.
+    // Throws std::invalid_argument if 2^M codes are not enough
+    explicit huffman(const std::vector<std::uint64_t>& freq);
+    // Build from code lengths, e.g. lengths() sent by the encoder.
+    // Throws std::invalid_argument on lengths that do not form a prefix code
+    explicit huffman(const std::vector<std::uint8_t>& lengths);
+
+    template <typename W>
+    inline void encode(W& w, std::size_t symbol) const;
+    template <typename R>
+    inline std::size_t decode(R& r) const;
+
+    // Code length of each symbol, 0 for symbols without a code
+    inline const std::vector<std::uint8_t>& lengths() const;
+
+  private:
+    struct entry{
+        std::uint16_t symbol;
+        std::uint8_t length;
+    };
+
+    std::vector<std::uint8_t> lens;
+    // Codes in stream order
+    std::vector<std::uint32_t> codes;
+    std::vector<entry> table;
+
+    void assign();
+};
+
+template <bitorder O, unsigned M>
+huffman<O, M>::huffman(const std::vector<std::uint64_t>& freq): lens(freq.size(), 0){
+    if(freq.size() > 0x10000u){
+        throw std::invalid_argument("huffman: too many symbols");
+    }
+    std::vector<std::size_t> used;
+    for(std::size_t s = 0; s != freq.size(); ++s){
+        if(freq[s] != 0){
+            used.push_back(s);
+        }
+    }
+    if(used.size() > (std::size_t(1) << M)){
+        throw std::invalid_argument("huffman: too many symbols for code length limit");
+    }
+    if(used.size() == 1){
+        lens[used[0]] = 1;
+    }else if(used.size() > 1){
+        // Depth of every leaf in a plain Huffman tree
+        const std::size_t n = used.size();
+        std::vector<std::size_t> parent(2 * n - 1, 0);
+        using node = std::pair<std::uint64_t, std::size_t>;
+        std::priority_queue<node, std::vector<node>, std::greater<node> > heap;
+        for(std::size_t i = 0; i != n; ++i){
+            heap.emplace(freq[used[i]], i);
+        }
+        for(std::size_t next = n; heap.size() > 1; ++next){
+            node a = heap.top();
+            heap.pop();
+            node b = heap.top();
+            heap.pop();
+            parent[a.second] = next;
+            parent[b.second] = next;
+            heap.emplace(a.first + b.first, next);
+        }
+        std::vector<std::size_t> depth(2 * n - 1, 0);
+        std::vector<std::size_t> count(n, 0);
+        for(std::size_t i = 2 * n - 2; i-- != 0;){
+            depth[i] = depth[parent[i]] + 1;
+        }
+        for(std::size_t i = 0; i != n; ++i){
+            ++count[depth[i]];
+        }
+
+        // Limit lengths to M the way of JPEG Annex K.3: move pairs of the
+        // deepest leaves up, and split a shallower leaf to make room
+        for(std::size_t i = n - 1; i > M; --i){
+            while(count[i] > 0){
+                std::size_t j = i - 2;
+                while(count[j] == 0){
+                    --j;
+                }
+                count[i] -= 2;
+                count[i - 1] += 1;
+                count[j + 1] += 2;
+                count[j] -= 1;
+            }
+        }
+
+        // Shorter codes to more frequent symbols
+        std::stable_sort(used.begin(), used.end(), [&](std::size_t a, std::size_t b){
+            return freq[a] > freq[b];
+        });
+        std::size_t s = 0;
+        for(std::size_t l = 1; l <= M && l < n; ++l){
+            for(std::size_t c = count[l]; c != 0; --c){
+                lens[used[s++]] = static_cast<std::uint8_t>(l);
+            }
+        }
+    }
+    assign();
+}
+
+template <bitorder O, unsigned M>
+huffman<O, M>::huffman(const std::vector<std::uint8_t>& lengths): lens(lengths){
+    if(lens.size() > 0x10000u){
+        throw std::invalid_argument("huffman: too many symbols");
+    }
+    // Kraft inequality in units of 2^-M
+    std::uint64_t kraft = 0;
+    for(std::uint8_t l: lens){
+        if(l > M){
+            throw std::invalid_argument("huffman: code length exceeds limit");
+        }
+        kraft += l ? std::uint64_t(1) << (M - l) : 0;
+    }
+    if(kraft > (std::uint64_t(1) << M)){
+        throw std::invalid_argument("huffman: lengths do not form a prefix code");
+    }
+    assign();
+}
+
+template <bitorder O, unsigned M>
+void huffman<O, M>::assign(){
+    codes.assign(lens.size(), 0);
+    // Invalid codes decode to symbol 0 and consume M bits
+    table.assign(std::size_t(1) << M, entry{0, static_cast<std::uint8_t>(M)});
+
+    std::uint32_t code = 0;
+    for(unsigned l = 1; l <= M; ++l){
+        for(std::size_t s = 0; s != lens.size(); ++s){
+            if(lens[s] != l){
+                continue;
+            }
+            const entry e{static_cast<std::uint16_t>(s), static_cast<std::uint8_t>(l)};
+            const std::size_t fill = std::size_t(1) << (M - l);
+            if(O == bitorder::msb){
+                codes[s] = code;
+                std::fill_n(table.begin() + (std::size_t(code) << (M - l)), fill, e);
+            }else{
+                codes[s] = static_cast<std::uint32_t>(detail::bcreverse(code, l));
+                for(std::size_t j = 0; j != fill; ++j){
+                    table[codes[s] | (j << l)] = e;
+                }
+            }
+            ++code;
+        }
+        code <<= 1;
+    }
+}
+
+template <bitorder O, unsigned M>
+template <typename W>
+void huffman<O, M>::encode(W& w, std::size_t symbol) const{
+    static_assert(W::order == O, "Writer must use the bit order of code");
+    w.write(codes[symbol], lens[symbol]);
+}
+
+template <bitorder O, unsigned M>
+template <typename R>
+std::size_t huffman<O, M>::decode(R& r) const{
+    static_assert(R::order == O, "Reader must use the bit order of code");
+    const entry e = table[r.peek(M)];
+    r.skip(e.length);
+    return e.symbol;
+}
+
+template <bitorder O, unsigned M>
+const std::vector<std::uint8_t>& huffman<O, M>::lengths() const{
+    return lens;
+}
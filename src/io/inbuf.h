@@ -0,0 +1,154 @@
+/*
+* Copyright (c) 2021 SdtElectronics . All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 
+* 2. Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+* 
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from this
+*    software without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <array>
+
+#include "bitops.h"
+
+// Reads bit fields in place from a byte span, e.g. data() of a bcbuf
+// written with the same bit order O. Nothing is copied, the span must
+// outlive the reader. Reading past the end yields zero bits.
+template <bitorder O = bitorder::lsb>
+class bcreader{
+  public:
+    static constexpr bitorder order = O;
+
+    // size: length of data in bytes
+    bcreader(const std::uint8_t* data, std::size_t size);
+    template <std::size_t L>
+    bcreader(const std::array<std::uint8_t, L>& data);
+
+    // Next nbits (1-64) of the stream without consuming them.
+    // With lsb order the first bit is the least significant one of result,
+    // with msb order it is the most significant one
+    inline std::uint64_t peek(unsigned nbits) const;
+    // Next nbits (1-64) of the stream, consumed
+    inline std::uint64_t read(unsigned nbits);
+    // Next single bit of the stream, consumed
+    inline bool read();
+    // Move the current position nbits forward
+    inline void skip(std::size_t nbits);
+
+    // Current position in bits
+    inline std::size_t tell() const;
+    // Number of bits left before the end of span
+    inline std::size_t left() const;
+
+  private:
+    const std::uint8_t* buf;
+    std::size_t size;
+    std::size_t pos;
+
+    // 8 bytes starting from the byte at offset, zero padded after the end
+    inline std::uint64_t word(std::size_t offset) const;
+};
+
+template <bitorder O>
+bcreader<O>::bcreader(const std::uint8_t* data, std::size_t size):
+    buf(data), size(size), pos(0){
+}
+
+template <bitorder O>
+template <std::size_t L>
+bcreader<O>::bcreader(const std::array<std::uint8_t, L>& data):
+    buf(data.data()), size(L), pos(0){
+}
+
+template <bitorder O>
+std::uint64_t bcreader<O>::word(std::size_t offset) const{
+    if(offset + 8 <= size){
+        return O == bitorder::lsb ? detail::bcloadle(buf + offset)
+                                  : detail::bcloadbe(buf + offset);
+    }
+    std::uint8_t tmp[8] = {};
+    if(offset < size){
+        std::memcpy(tmp, buf + offset, size - offset);
+    }
+    return O == bitorder::lsb ? detail::bcloadle(tmp) : detail::bcloadbe(tmp);
+}
+
+template <bitorder O>
+std::uint64_t bcreader<O>::peek(unsigned nbits) const{
+    const std::size_t offset = pos >> 3;
+    const unsigned shift = pos & 0x07u;
+    std::uint64_t w = word(offset);
+    if(O == bitorder::lsb){
+        w >>= shift;
+        // A word holds at least 57 bits past the current position
+        if(nbits > 57 && shift != 0){
+            w |= word(offset + 8) << (64 - shift);
+        }
+        return w & detail::bcmask(nbits);
+    }else{
+        w <<= shift;
+        if(nbits > 57 && shift != 0){
+            w |= word(offset + 8) >> (64 - shift);
+        }
+        return w >> (64 - nbits);
+    }
+}
+
+template <bitorder O>
+std::uint64_t bcreader<O>::read(unsigned nbits){
+    std::uint64_t value = peek(nbits);
+    pos += nbits;
+    return value;
+}
+
+template <bitorder O>
+bool bcreader<O>::read(){
+    const std::size_t offset = pos >> 3;
+    const unsigned shift = pos & 0x07u;
+    ++pos;
+    if(offset >= size){
+        return false;
+    }
+    return (buf[offset] >> (O == bitorder::lsb ? shift : 0x07u - shift)) & 1u;
+}
+
+template <bitorder O>
+void bcreader<O>::skip(std::size_t nbits){
+    pos += nbits;
+}
+
+template <bitorder O>
+std::size_t bcreader<O>::tell() const{
+    return pos;
+}
+
+template <bitorder O>
+std::size_t bcreader<O>::left() const{
+    return pos < size * 8 ? size * 8 - pos : 0;
+}
@@ -28,36 +28,209 @@
 * POSSIBILITY OF SUCH DAMAGE.
 */
 
+#pragma once
+
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <array>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include "bitops.h"
+
+#ifdef BCIO_X86
+#include <immintrin.h>
+#endif
 
 inline std::uint8_t setbit(std::uint8_t c, int i, bool bit){
     return c |= bit << i;
 }
 
-template <std::size_t L>
+namespace detail{
+
+// Bit reversal of every byte value
+constexpr std::array<std::uint8_t, 256> bcrevtable(){
+    std::array<std::uint8_t, 256> table{};
+    for(unsigned v = 0; v != 256; ++v){
+        unsigned r = 0;
+        for(unsigned i = 0; i != 8; ++i){
+            r |= ((v >> i) & 1u) << (7 - i);
+        }
+        table[v] = static_cast<std::uint8_t>(r);
+    }
+    return table;
+}
+
+constexpr std::array<std::uint8_t, 256> bcrev = bcrevtable();
+
+// Turn every non-zero byte of w into 0x01
+inline std::uint64_t bcnormalize(std::uint64_t w){
+    constexpr std::uint64_t low7 = 0x7f7f7f7f7f7f7f7full;
+    return ((((w & low7) + low7) | w) >> 7) & 0x0101010101010101ull;
+}
+
+// Gather the lowest bit of each byte of w, byte 0 to bit 0
+inline std::uint8_t bcpack8(std::uint64_t w){
+    return static_cast<std::uint8_t>((w * 0x0102040810204080ull) >> 56);
+}
+
+// Gather the lowest bit of each byte of w, byte 0 to bit 7
+inline std::uint8_t bcpack8r(std::uint64_t w){
+    return static_cast<std::uint8_t>((w * 0x8040201008040201ull) >> 56);
+}
+
+// Kernels pack 8 * n bytes from src into n bytes at dst,
+// every non-zero input byte becomes a set bit
+using bcpack_fn = void (*)(const std::uint8_t* src, std::size_t n, std::uint8_t* dst);
+
+inline void bcpack_swar(const std::uint8_t* src, std::size_t n, std::uint8_t* dst){
+    for(std::size_t i = 0; i != n; ++i){
+        dst[i] = bcpack8(bcnormalize(bcloadle(src + 8 * i)));
+    }
+}
+
+inline void bcpackr_swar(const std::uint8_t* src, std::size_t n, std::uint8_t* dst){
+    for(std::size_t i = 0; i != n; ++i){
+        dst[i] = bcpack8r(bcnormalize(bcloadle(src + 8 * i)));
+    }
+}
+
+#ifdef BCIO_X86
+// Mask with bit i set if byte i of 16 bytes at src is non-zero
+__attribute__((target("sse2")))
+inline unsigned bcmask16(const std::uint8_t* src){
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    return ~static_cast<unsigned>(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(v, _mm_setzero_si128()))) & 0xffffu;
+}
+
+__attribute__((target("avx2")))
+inline std::uint32_t bcmask32(const std::uint8_t* src){
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+    return ~static_cast<std::uint32_t>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(v, _mm256_setzero_si256())));
+}
+
+__attribute__((target("sse2")))
+inline void bcpack_sse2(const std::uint8_t* src, std::size_t n, std::uint8_t* dst){
+    std::size_t i = 0;
+    for(; i + 2 <= n; i += 2){
+        unsigned m = bcmask16(src + 8 * i);
+        dst[i]     = static_cast<std::uint8_t>(m);
+        dst[i + 1] = static_cast<std::uint8_t>(m >> 8);
+    }
+    bcpack_swar(src + 8 * i, n - i, dst + i);
+}
+
+__attribute__((target("sse2")))
+inline void bcpackr_sse2(const std::uint8_t* src, std::size_t n, std::uint8_t* dst){
+    std::size_t i = 0;
+    for(; i + 2 <= n; i += 2){
+        unsigned m = bcmask16(src + 8 * i);
+        dst[i]     = bcrev[m & 0xffu];
+        dst[i + 1] = bcrev[m >> 8];
+    }
+    bcpackr_swar(src + 8 * i, n - i, dst + i);
+}
+
+__attribute__((target("avx2")))
+inline void bcpack_avx2(const std::uint8_t* src, std::size_t n, std::uint8_t* dst){
+    std::size_t i = 0;
+    for(; i + 4 <= n; i += 4){
+        std::uint32_t m = bcmask32(src + 8 * i);
+        std::memcpy(dst + i, &m, 4);
+    }
+    bcpack_sse2(src + 8 * i, n - i, dst + i);
+}
+
+__attribute__((target("avx2")))
+inline void bcpackr_avx2(const std::uint8_t* src, std::size_t n, std::uint8_t* dst){
+    std::size_t i = 0;
+    for(; i + 4 <= n; i += 4){
+        std::uint32_t m = bcmask32(src + 8 * i);
+        dst[i]     = bcrev[m & 0xffu];
+        dst[i + 1] = bcrev[(m >> 8) & 0xffu];
+        dst[i + 2] = bcrev[(m >> 16) & 0xffu];
+        dst[i + 3] = bcrev[m >> 24];
+    }
+    bcpackr_sse2(src + 8 * i, n - i, dst + i);
+}
+#endif
+
+struct bcpackers{
+    bcpack_fn pack;
+    bcpack_fn packr;
+};
+
+// Kernels for the running CPU, selected once
+inline const bcpackers& bcpacker(){
+    static const bcpackers selected = []{
+#ifdef BCIO_X86
+        if(bccpu().avx2){
+            return bcpackers{bcpack_avx2, bcpackr_avx2};
+        }
+        if(bccpu().sse2){
+            return bcpackers{bcpack_sse2, bcpackr_sse2};
+        }
+#endif
+        return bcpackers{bcpack_swar, bcpackr_swar};
+    }();
+    return selected;
+}
+
+// Iterators which can be packed with the vectorized kernels: pointers to
+// bool or uint8_t, and iterators of std::vector<uint8_t>
+// (std::vector<bool> is not contiguous)
+template <typename T>
+struct bccontiguous{
+    using value_type = typename std::remove_cv<
+                        typename std::iterator_traits<T>::value_type>::type;
+    static constexpr bool value = (std::is_pointer<T>::value &&
+                                   (std::is_same<value_type, bool>::value ||
+                                    std::is_same<value_type, std::uint8_t>::value)) ||
+                                  std::is_same<T, std::vector<std::uint8_t>::iterator>::value ||
+                                  std::is_same<T, std::vector<std::uint8_t>::const_iterator>::value;
+};
+
+// Keeps write(value, nbits) from matching the iterator range overloads
+template <typename T>
+using bciter = typename std::enable_if<!std::is_integral<T>::value>::type;
+
+} // namespace detail
+
+// O: bit order of the stream, see bitops.h
+template <std::size_t L, bitorder O = bitorder::lsb>
 class bcbuf{
   public:
     bcbuf();
     using buf_data = std::array<std::uint8_t, L>;
+    static constexpr bitorder order = O;
 
     // Write a single bit after the current position
     // and move the current position a bit forward
     inline void write(bool bit);
 
-    // Write bytes from begin to end 
-    // with the same bit order as input
+    // Write the lowest nbits (1-64) of value after the current position,
+    // starting from the least significant bit if O is lsb, or from the
+    // most significant one if O is msb
+    inline void write(std::uint64_t value, unsigned nbits);
+
+    // Write bits from begin to end in the same order as input.
+    // Contiguous bool or uint8_t ranges (pointers) are packed with SIMD
     template <typename T>
-    inline void write(T begin, T end);
+    inline detail::bciter<T> write(T begin, T end);
 
-    // Write bytes from begin to end 
-    // with the inverse bit order as input
+    // Write bits from begin to end with the order of every 8 bits reversed.
+    // A trailing group of n < 8 bits is reversed within its n bits
     template <typename T>
-    inline void write_reverse(T begin, T end)
+    inline detail::bciter<T> write_reverse(T begin, T end);
 
     inline buf_data& data();
 
+    // Number of bits written
+    inline std::size_t bits() const;
     
     inline void reset();
 
@@ -65,55 +238,173 @@ class bcbuf{
     buf_data buf;
     typename buf_data::iterator cur;
     std::size_t bcount;
+
+    // R: place the first input bit at the highest bit of a byte
+    template <bool R, typename T>
+    inline void pack(T begin, T end, std::true_type contiguous);
+    template <bool R, typename T>
+    inline void pack(T begin, T end, std::false_type contiguous);
+    // Write the last n < 8 bits held in the low bit of each byte of w
+    template <bool R>
+    inline void packTail(std::uint64_t w, std::size_t n);
     
 };
 
-template <std::size_t L>
-bcbuf<L>::bcbuf(): cur(buf.begin()){
+template <std::size_t L, bitorder O>
+bcbuf<L, O>::bcbuf(): buf(), cur(buf.begin()), bcount(0){
 }
 
-template <std::size_t L>
-typename bcbuf<L>::buf_data& bcbuf<L>::data(){
+template <std::size_t L, bitorder O>
+typename bcbuf<L, O>::buf_data& bcbuf<L, O>::data(){
     return buf;
 }
 
-template <std::size_t L>
-void bcbuf<L>::reset(){
+template <std::size_t L, bitorder O>
+std::size_t bcbuf<L, O>::bits() const{
+    return bcount;
+}
+
+template <std::size_t L, bitorder O>
+void bcbuf<L, O>::reset(){
     bcount = 0;
     cur = buf.begin();
 }
 
-template <std::size_t L>
-void bcbuf<L>::write(bool bit){
+template <std::size_t L, bitorder O>
+void bcbuf<L, O>::write(bool bit){
     std::size_t mod = (bcount++) & 0x07u;
     std::uint8_t tmp = *cur;
     tmp = mod ? tmp : 0x00;
-    *cur = setbit(tmp, mod, bit);
+    *cur = setbit(tmp, O == bitorder::lsb ? mod : 0x07u - mod, bit);
     cur += mod == 0x07u;
 }
 
-template <std::size_t L>
+template <std::size_t L, bitorder O>
+void bcbuf<L, O>::write(std::uint64_t value, unsigned nbits){
+    // A field and the bits already in the current byte must fit in a word
+    if(nbits > 56){
+        if(O == bitorder::lsb){
+            write(value, 32);
+            write(value >> 32, nbits - 32);
+        }else{
+            write(value >> 32, nbits - 32);
+            write(value, 32);
+        }
+        return;
+    }
+    value &= detail::bcmask(nbits);
+    std::size_t pos = bcount & 0x07u;
+    if(buf.end() - cur < 8){
+        // Not enough room for a whole word near the end of buffer
+        for(unsigned i = 0; i != nbits; ++i){
+            unsigned shift = O == bitorder::lsb ? i : nbits - 1 - i;
+            write(static_cast<bool>((value >> shift) & 1u));
+        }
+        return;
+    }
+    std::uint8_t* dst = &*cur;
+    if(O == bitorder::lsb){
+        std::uint64_t w = detail::bcloadle(dst) & ((std::uint64_t(1) << pos) - 1);
+        detail::bcstorele(dst, w | value << pos);
+    }else{
+        std::uint64_t w = detail::bcloadbe(dst) & ~(~std::uint64_t(0) >> pos);
+        detail::bcstorebe(dst, w | value << (64 - pos - nbits));
+    }
+    bcount += nbits;
+    cur = buf.begin() + (bcount >> 3);
+}
+
+template <std::size_t L, bitorder O>
 template <typename T>
-inline void bcbuf<L>::write(T begin, T end){
-    while(begin != end){
-        std::uint8_t tmp = 0x00;
-        // -O3 would unroll this automatically
-        for(std::size_t i = 0; i != 8; ++i){
-            tmp = setbit(tmp, i, *(begin++));
+inline detail::bciter<T> bcbuf<L, O>::write(T begin, T end){
+    // Whole bytes can only be stored at a byte boundary
+    if(bcount & 0x07u){
+        while(begin != end){
+            write(static_cast<bool>(*(begin++)));
         }
-        *(cur++) = tmp;
+        return;
     }
+    pack<O == bitorder::msb>(begin, end, std::integral_constant<bool, detail::bccontiguous<T>::value>());
 }
 
-template <std::size_t L>
+template <std::size_t L, bitorder O>
 template <typename T>
-inline void bcbuf<L>::write_reverse(T begin, T end){
+inline detail::bciter<T> bcbuf<L, O>::write_reverse(T begin, T end){
+    if(bcount & 0x07u){
+        std::uint64_t w = 0;
+        std::size_t i = 0;
+        for(; begin != end; ++i){
+            w |= std::uint64_t(static_cast<bool>(*(begin++))) << (8 * (i & 0x07u));
+            if((i & 0x07u) == 0x07u){
+                std::uint8_t byte = detail::bcpack8r(w);
+                for(std::size_t b = 0; b != 8; ++b){
+                    write(static_cast<bool>((byte >> b) & 1u));
+                }
+                w = 0;
+            }
+        }
+        std::size_t n = i & 0x07u;
+        for(std::size_t b = n; b != 0; --b){
+            write(static_cast<bool>((w >> (8 * (b - 1))) & 1u));
+        }
+        return;
+    }
+    pack<O == bitorder::lsb>(begin, end, std::integral_constant<bool, detail::bccontiguous<T>::value>());
+}
+
+template <std::size_t L, bitorder O>
+template <bool R, typename T>
+inline void bcbuf<L, O>::pack(T begin, T end, std::true_type){
+    std::size_t n = static_cast<std::size_t>(end - begin);
+    if(n == 0){
+        return;
+    }
+    const std::uint8_t* src = reinterpret_cast<const std::uint8_t*>(&*begin);
+    std::size_t bytes = n >> 3;
+    const auto& packer = detail::bcpacker();
+    (R ? packer.packr : packer.pack)(src, bytes, &*cur);
+    cur += bytes;
+    bcount += bytes << 3;
+
+    src += bytes << 3;
+    std::uint64_t w = 0;
+    for(std::size_t i = 0; i != (n & 0x07u); ++i){
+        w |= std::uint64_t(src[i] != 0) << (8 * i);
+    }
+    packTail<R>(w, n & 0x07u);
+}
+
+template <std::size_t L, bitorder O>
+template <bool R, typename T>
+inline void bcbuf<L, O>::pack(T begin, T end, std::false_type){
     while(begin != end){
-        std::uint8_t tmp = 0x00;
-        // -O3 would unroll this automatically
-        for(std::size_t i = 7; i >= 0; --i){
-            tmp = setbit(tmp, i, *(begin++));
+        std::uint64_t w = 0;
+        std::size_t i = 0;
+        for(; i != 8 && begin != end; ++i){
+            w |= std::uint64_t(static_cast<bool>(*(begin++))) << (8 * i);
+        }
+        if(i != 8){
+            packTail<R>(w, i);
+            return;
         }
-        *(cur++) = tmp;
+        *(cur++) = R ? detail::bcpack8r(w) : detail::bcpack8(w);
+        bcount += 8;
+    }
+}
+
+template <std::size_t L, bitorder O>
+template <bool R>
+inline void bcbuf<L, O>::packTail(std::uint64_t w, std::size_t n){
+    if(n == 0){
+        return;
+    }
+    // Write reversal keeps the bits within the first n positions of stream
+    if(O == bitorder::lsb){
+        *cur = R ? static_cast<std::uint8_t>(detail::bcpack8r(w) >> (8 - n))
+                 : detail::bcpack8(w);
+    }else{
+        *cur = R ? detail::bcpack8r(w)
+                 : static_cast<std::uint8_t>(detail::bcpack8(w) << (8 - n));
     }
+    bcount += n;
 }
\ No newline at end of file
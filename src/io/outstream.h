@@ -0,0 +1,365 @@
+/*
+* Copyright (c) 2021 SdtElectronics . All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 
+* 2. Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+* 
+* 3. Neither the name of the copyright holder nor the names of its
+*    contributors may be used to endorse or promote products derived from this
+*    software without specific prior written permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "outbuf.h"
+
+// Sink writing flushed blocks to a file descriptor with writev
+class fdsink{
+  public:
+    fdsink(int fd);
+    void operator()(const iovec* blocks, int count);
+
+  private:
+    int fd;
+};
+
+// Sink invoking f(data, size) for every flushed block
+template <typename F>
+class cbsink{
+  public:
+    cbsink(F f);
+    void operator()(const iovec* blocks, int count);
+
+  private:
+    F f;
+};
+
+template <typename F>
+cbsink<F> makeSink(F f){
+    return cbsink<F>(f);
+}
+
+// Bit sink streaming into N rotating bcbuf blocks of L bytes.
+// Whenever a block fills it is handed to sink and writing carries on in
+// the next block. With background flushing the sink runs on a dedicated
+// thread, and the writer only waits when all N blocks are still in flight.
+// S: callable as sink(const iovec* blocks, int count), e.g. fdsink or cbsink
+template <std::size_t L, typename S, std::size_t N = 2, bitorder O = bitorder::lsb>
+class bcstream{
+    static_assert(N >= 2, "At least two blocks are needed to overlap flushing");
+
+  public:
+    static constexpr bitorder order = O;
+
+    // background: flush on a dedicated thread instead of the writing one
+    bcstream(S s, bool background = true);
+    // Flushes everything written, errors of sink are discarded
+    ~bcstream();
+
+    // Same as the write functions of bcbuf, across block boundaries
+    inline void write(bool bit);
+    inline void write(std::uint64_t value, unsigned nbits);
+    // T must be a forward iterator
+    template <typename T>
+    inline detail::bciter<T> write(T begin, T end);
+    template <typename T>
+    inline detail::bciter<T> write_reverse(T begin, T end);
+
+    // Hand the partially filled block to sink, padded to a whole byte,
+    // and wait until all blocks are flushed.
+    // Rethrows the exception raised by sink, if any
+    void flush();
+
+    // Number of bits written, including padding of flush()
+    inline std::size_t bits() const;
+
+  private:
+    static constexpr std::size_t capacity = L * 8;
+
+    S sink;
+    std::array<bcbuf<L, O>, N> blocks;
+    std::array<std::size_t, N> sizes;
+    bcbuf<L, O>* cur;
+    std::size_t written;
+
+    // Blocks handed to sink and blocks done flushing, both ever increasing
+    std::size_t filled;
+    std::size_t flushed;
+    bool stop;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable done;
+    std::thread flusher;
+
+    inline std::size_t room() const;
+    template <bool R, typename T>
+    void writeRange(T begin, T end);
+    // Hand over the current block and move to the next free one
+    void rotate();
+    void drain();
+};
+
+inline fdsink::fdsink(int fd): fd(fd){
+}
+
+inline void fdsink::operator()(const iovec* blocks, int count){
+    // POSIX guarantees at least 16 buffers per writev
+    iovec iov[16];
+    while(count != 0){
+        int n = count < static_cast<int>(sizeof(iov) / sizeof(iovec)) ?
+                count : static_cast<int>(sizeof(iov) / sizeof(iovec));
+        std::copy(blocks, blocks + n, iov);
+        int first = 0;
+        while(first != n){
+            ssize_t ret = ::writev(fd, iov + first, n - first);
+            if(ret < 0){
+                if(errno == EINTR){
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "writev");
+            }
+            // Skip what is written, partially written block is adjusted
+            std::size_t left = static_cast<std::size_t>(ret);
+            while(first != n && left >= iov[first].iov_len){
+                left -= iov[first++].iov_len;
+            }
+            if(first != n){
+                iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + left;
+                iov[first].iov_len -= left;
+            }
+        }
+        blocks += n;
+        count -= n;
+    }
+}
+
+template <typename F>
+cbsink<F>::cbsink(F f): f(f){
+}
+
+template <typename F>
+void cbsink<F>::operator()(const iovec* blocks, int count){
+    for(int i = 0; i != count; ++i){
+        f(static_cast<const std::uint8_t*>(blocks[i].iov_base), blocks[i].iov_len);
+    }
+}
+
+template <std::size_t L, typename S, std::size_t N, bitorder O>
+bcstream<L, S, N, O>::bcstream(S s, bool background):
+    sink(s), cur(&blocks[0]), written(0), filled(0), flushed(0), stop(false){
+    if(background){
+        flusher = std::thread([this]{drain();});
+    }
+}
+
+template <std::size_t L, typename S, std::size_t N, bitorder O>
+bcstream<L, S, N, O>::~bcstream(){
+    try{
+        flush();
+    }catch(...){
+    }
+    if(flusher.joinable()){
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            stop = true;
+        }
+        ready.notify_one();
+        flusher.join();
+    }
+}
+
+template <std::size_t L, typename S, std::size_t N, bitorder O>
+std::size_t bcstream<L, S, N, O>::room() const{
+    return capacity - cur->bits();
+}
+
+template <std::size_t L, typename S, std::size_t N, bitorder O>
+std::size_t bcstream<L, S, N, O>::bits() const{
+    return written + cur->bits();
+}
+
+template <std::size_t L, typename S, std::size_t N, bitorder O>
+void bcstream<L, S, N, O>::write(bool bit){
+    cur->write(bit);
+    if(cur->bits() == capacity){
+        rotate();
+    }
+}
+
+template <std::size_t L, typename S, std::size_t N, bitorder O>
+void bcstream<L, S, N, O>::write(std::uint64_t value, unsigned nbits){
+    // Split the field at block boundaries, room is never 0
+    while(nbits >= room()){
+        const unsigned head = static_cast<unsigned>(room());
+        nbits -= head;
+        if(O == bitorder::lsb){
+            cur->write(value, head);
+            value = nbits != 0 ? value >> head : 0;
+        }else{
+            cur->write(value >> nbits, head);
+        }
+        rotate();
+        if(nbits == 0){
+            return;
+        }
+    }
+    cur->write(value, nbits);
+}
+
+template <std::size_t L, typename S, std::size_t N, bitorder O>
+template <typename T>
+detail::bciter<T> bcstream<L, S, N, O>::write(T begin, T end){
+    writeRange<false>(begin, end);
+}
+
+template <std::size_t L, typename S, std::size_t N, bitorder O>
+template <typename T>
+detail::bciter<T> bcstream<L, S, N, O>::write_reverse(T begin, T end){
+    writeRange<true>(begin, end);
+}
+
+template <std::size_t L, typename S, std::size_t N, bitorder O>
+template <bool R, typename T>
+void bcstream<L, S, N, O>::writeRange(T begin, T end){
+    std::size_t n = static_cast<std::size_t>(std::distance(begin, end));
+    while(n != 0){
+        std::size_t take = n < room() ? n : room();
+        // Groups of 8 reversed bits must not straddle a block boundary
+        if(R && take != n){
+            take -= take & 0x07u;
+        }
+        if(take == 0){
+            // Reverse a straddling group here and write it in order
+            std::uint8_t group[8];
+            std::size_t k = n < 8 ? n : 8;
+            for(std::size_t i = k; i != 0; --i){
+                group[i - 1] = static_cast<bool>(*(begin++));
+            }
+            writeRange<false>(group, group + k);
+            n -= k;
+            continue;
+        }
+        T last = std::next(begin, take);
+        if(R){
+            cur->write_reverse(begin, last);
+        }else{
+            cur->write(begin, last);
+        }
+        begin = last;
+        n -= take;
+        if(room() == 0){
+            rotate();
+        }
+    }
+}
+
+template <std::size_t L, typename S, std::size_t N, bitorder O>
+void bcstream<L, S, N, O>::rotate(){
+    const std::size_t bytes = (cur->bits() + 7) >> 3;
+    written += bytes << 3;
+    sizes[filled % N] = bytes;
+    if(flusher.joinable()){
+        std::unique_lock<std::mutex> lk(mutex);
+        ++filled;
+        ready.notify_one();
+        // The next block is free once it has been flushed
+        done.wait(lk, [this]{return filled - flushed < N;});
+        blocks[filled % N].reset();
+        cur = &blocks[filled % N];
+        if(error){
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }else{
+        iovec iov{blocks[filled % N].data().data(), bytes};
+        ++filled;
+        flushed = filled;
+        blocks[filled % N].reset();
+        cur = &blocks[filled % N];
+        sink(&iov, 1);
+    }
+}
+
+template <std::size_t L, typename S, std::size_t N, bitorder O>
+void bcstream<L, S, N, O>::flush(){
+    if(cur->bits() != 0){
+        rotate();
+    }
+    if(flusher.joinable()){
+        std::unique_lock<std::mutex> lk(mutex);
+        done.wait(lk, [this]{return filled == flushed;});
+        if(error){
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+template <std::size_t L, typename S, std::size_t N, bitorder O>
+void bcstream<L, S, N, O>::drain(){
+    std::unique_lock<std::mutex> lk(mutex);
+    while(true){
+        ready.wait(lk, [this]{return filled != flushed || stop;});
+        if(filled == flushed){
+            return;
+        }
+        // Flush every pending block with a single call
+        const std::size_t first = flushed;
+        const std::size_t last = filled;
+        lk.unlock();
+        iovec iov[N];
+        int count = 0;
+        for(std::size_t i = first; i != last; ++i){
+            iov[count++] = iovec{blocks[i % N].data().data(), sizes[i % N]};
+        }
+        std::exception_ptr e;
+        try{
+            sink(iov, count);
+        }catch(...){
+            e = std::current_exception();
+        }
+        lk.lock();
+        flushed = last;
+        if(e){
+            error = e;
+        }
+        done.notify_one();
+    }
+}
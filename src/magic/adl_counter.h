@@ -84,31 +84,65 @@ private:
         }
     };
 
-    template<std::size_t nCurrent, bool bWasSet /* = false */>
-    struct CheckerSetter
+    /*
+        Flags of Element<0> ... Element<n - 1> are set and the rest are not,
+        so the first unset flag is found by probing 0, 1, 3, 7, ... until an
+        unset flag and then bisecting the last interval. Every call takes
+        O(log n) instantiations instead of O(n) for a linear scan.
+    */
+
+    // First unset flag lies in [nLow, nHigh]
+    template<std::size_t nLow, std::size_t nHigh>
+    struct BinarySearcher
+    {
+        template<
+            std::size_t nMid    = nLow + (nHigh - nLow) / 2,
+            bool        bWasSet = constexpr_flag<Element<nMid>> {}.test(),
+            std::size_t nNext   = BinarySearcher<
+                                    bWasSet ? nMid + 1 : nLow,
+                                    bWasSet ? nHigh : nMid> {}.index()>
+        static constexpr std::size_t index(void) noexcept
+        {
+            return nNext;
+        }
+    };
+
+    template<std::size_t nFound>
+    struct BinarySearcher<nFound, nFound>
     {
         static constexpr std::size_t index(void) noexcept
         {
-            return nCurrent;
+            return nFound;
+        }
+    };
+
+    template<std::size_t nProbe, bool bWasSet /* = false */>
+    struct ExponentialSetter
+    {
+        // Previous probe (nProbe - 1) / 2 was set
+        template<std::size_t nNext = BinarySearcher<(nProbe + 1) / 2, nProbe> {}.index()>
+        static constexpr std::size_t index(void) noexcept
+        {
+            return nNext;
         }
     };
 
-    template<T nCurrent>
-    struct CheckerWrapper
+    template<std::size_t nProbe>
+    struct ExponentialSearcher
     {
         template<
-            bool        bWasSet = constexpr_flag<Element<nCurrent>> {}.test(),
-            std::size_t nNext   = CheckerSetter<nCurrent, bWasSet> {}.index()>
+            bool        bWasSet = constexpr_flag<Element<nProbe>> {}.test(),
+            std::size_t nNext   = ExponentialSetter<nProbe, bWasSet> {}.index()>
         static constexpr std::size_t index(void) noexcept
         {
             return nNext;
         }
     };
 
-    template<std::size_t nCurrent>
-    struct CheckerSetter<nCurrent, /* bool bWasSet = */ true>
+    template<std::size_t nProbe>
+    struct ExponentialSetter<nProbe, /* bool bWasSet = */ true>
     {
-        template<std::size_t nNext = CheckerWrapper<nCurrent + 1> {}.index()>
+        template<std::size_t nNext = ExponentialSearcher<2 * nProbe + 1> {}.index()>
         static constexpr std::size_t index(void) noexcept
         {
             return nNext;
@@ -127,7 +161,7 @@ public:
         @retval         - current sequence value
     **/
     template<
-        std::size_t nIndex = CheckerWrapper<0> {}.index(),
+        std::size_t nIndex = ExponentialSearcher<0> {}.index(),
         T           _value = Element<nIndex> {}.value()>
     static constexpr T value(void) noexcept
     {
@@ -146,7 +180,7 @@ public:
         @retval         - next sequence value
     **/
     template<
-        std::size_t nIndex = CheckerWrapper<0> {}.index(),
+        std::size_t nIndex = ExponentialSearcher<0> {}.index(),
         T           _value = Element<nIndex> {}.value(),
         bool        bStub  = constexpr_flag<Element<nIndex>> {}.test_and_set()>
     static constexpr T next(void) noexcept
@@ -4,17 +4,25 @@
 
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <deque>
 #include <exception>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "evtMap.h"
+#include "evtParts.h"
 #include "queue.h"
 
 
 // Type traits to deduce the instance type of member function pointer
 template <typename> struct member_function_traits;
 
-template<typename T>
+// T: enum of events
+// P: EventPart flags of the optional parts to build in, see evtParts.h
+template<typename T, unsigned P = 0>
 class EventEngine{
     static_assert(std::is_enum<T>::value, "T must be an enum type");
     template<typename FP>
@@ -22,7 +30,9 @@ class EventEngine{
 
   public:
     // capacity: maximum number events in queue, pushing more is blocking
-    EventEngine(std::size_t capacity);
+    // replies: maximum number of emitWithReply() requests in flight,
+    //          unused without evtReplies
+    EventEngine(std::size_t capacity, std::size_t replies = 64);
 
     // Start the engine
     // cbList: Pointer to the first element in callback list
@@ -45,86 +55,532 @@ class EventEngine{
     template<typename F>
     void ignite(F* cbList, F onFinish, instanceType<F>& instance);
 
-    // Stop the engine
-    void stall(); 
-    // Push a new event to queue
+    // Start the engine with handlers looked up in an EventMap,
+    // events without a registered handler are dropped
+    template<typename... C>
+    void ignite(const EventMap<C...>& map);
+    // onFinish: Callback to be invoked when a loop is finished
+    template<typename... C>
+    void ignite(const EventMap<C...>& map,
+                typename EventMap<C...>::handler_type onFinish);
+    // instance: instance that member function to be called on
+    template<typename... C>
+    void ignite(const EventMap<C...>& map,
+                instanceType<typename EventMap<C...>::handler_type>& instance);
+    // onFinish: Callback to be invoked when a loop is finished
+    // instance: instance that member function to be called on
+    template<typename... C>
+    void ignite(const EventMap<C...>& map,
+                typename EventMap<C...>::handler_type onFinish,
+                instanceType<typename EventMap<C...>::handler_type>& instance);
+
+    // Handle at most maxEvents queued events on the calling thread and
+    // return the number handled, without blocking for more.
+    // handlers: any handler argument list accepted by ignite() except
+    //           onFinish, i.e. (cbList), (cbList, instance), (map) or
+    //           (map, instance)
+    template<typename... H>
+    std::size_t poll(std::size_t maxEvents, H&&... handlers);
+    // Handle queued events on the calling thread until the queue is empty
+    // or duration has elapsed and return the number handled. The clock is
+    // checked after every batch (see batch()), so a long handler can
+    // overrun duration
+    template<typename Rep, typename Period, typename... H>
+    std::size_t runFor(std::chrono::duration<Rep, Period> duration, H&&... handlers);
+
+    // Stop the engine, the engine can not be restarted afterwards.
+    // Events still queued are discarded, and their emitWithReply()
+    // requests complete with 0. Returns the number of events discarded
+    std::size_t stall();
+    // Push a new event to queue.
+    // Called from a handler of this engine, or from the completion callback
+    // of ignite(), the event is instead appended to a continuation queue of
+    // the calling thread, which takes no lock and has no capacity limit.
+    // Continuations run right after the emitting handler (or callback)
+    // returns, before the next queued event
     inline void emit(T event);
+    // Push a new event to queue and return a handle to wait for its reply.
+    // Blocks while all reply slots are in use. Once stall() is called the
+    // request is completed with 0 right away. Requires evtReplies
+    inline typename detail::evtReplyPart<T, (P & evtReplies) != 0>::handle_type emitWithReply(T event);
+    // Reply slot of the event being handled on the calling thread,
+    // nullptr if it was not emitted with emitWithReply(). Requires evtReplies
+    static inline EventReply* reply();
+    // Record every emitted event into journal, nullptr to stop recording.
+    // journal must outlive the engine or be detached first.
+    // Requires evtJournaled
+    void journal(EventJournal<T>* journal);
+    // Also consume events emitted into source by other processes,
+    // nullptr to detach. Must not be called while the engine is running.
+    // Requires evtShared
+    void attach(ShmEventSource<T>* source);
+
+    // Dequeue up to n events per lock of the queue, 1 by default and
+    // at most 256. Can be changed while the engine is running
+    inline void batch(std::size_t n);
+    inline std::size_t batch() const;
+    // Number of events waiting in queue
+    inline std::size_t pending();
+    // Number of local events handled so far
+    inline std::uint64_t processed() const;
+    // Maximum length of a chain of continuations, and maximum number of
+    // continuations waiting to run, 1024 by default.
+    // Events emitted beyond either go through the queue, so other queued
+    // events get their turn; if the queue is full they stay continuations,
+    // since the engine thread must never block on its own queue
+    inline void chainLimit(std::size_t n);
 
   private:
+    // Callable handling one event with the given handler arguments
+    template<typename F>
+    static auto dispatcher(F* cbList);
+    template<typename F>
+    static auto dispatcher(F* cbList, instanceType<F>& instance);
+    template<typename... C>
+    static auto dispatcher(const EventMap<C...>& map);
+    template<typename... C>
+    static auto dispatcher(const EventMap<C...>& map,
+                           instanceType<typename EventMap<C...>::handler_type>& instance);
+
+    // Run dispatch(event) on each queued event and finish() on each
+    // drained queue until stall() is called
+    template<typename D, typename E>
+    void loop(D dispatch, E finish);
+    // Run dispatch(event) on at most max queued events, stop early if
+    // expired() holds after a batch. Returns the number of events handled
+    template<typename D, typename X>
+    std::size_t drain(D& dispatch, std::size_t max, X expired);
+    // dispatch(event) between handler trace records
+    template<typename D>
+    static inline void handle(D& dispatch, T event);
+
+    using Continuations = std::vector<std::pair<T, std::size_t> >;
+
+    // Continuations emitted on one thread within one drain() of an engine,
+    // or by the completion callback of its ignite() loop
+    struct Chain{
+        EventEngine<T, P>* engine;
+        // Events with their chain depth, handled from next onwards
+        Continuations& events;
+        std::size_t next;
+        // Depth of the event being handled
+        std::size_t depth;
+        // Chain of an enclosing drain() on the same thread, if any
+        Chain* outer;
+        // Number of enclosing chains
+        std::size_t level;
+    };
+    static inline thread_local Chain* chain_ = nullptr;
+    // Continuation buffers of this thread, one per nesting level of
+    // drain(). They are cleared but never freed, so chaining stops
+    // allocating once they have grown; a deque keeps them in place
+    static inline thread_local std::deque<Continuations> buffers_;
+
+    // Makes the calling thread handle events emitted to engine as
+    // continuations for its lifetime, restores the enclosing chain on
+    // return and when a handler throws
+    struct Link{
+        inline Link(EventEngine<T, P>* engine);
+        inline ~Link();
+        Chain chain;
+
+        Link(const Link&) = delete;
+        Link& operator = (const Link&) = delete;
+    };
+    // Cleared continuation buffer of nesting level
+    static inline Continuations& buffer(std::size_t level);
+
+    // Handle continuations of chain until there are none left,
+    // returns the number handled
+    template<typename D>
+    std::size_t unwind(D& dispatch, Chain& chain);
+    // Append event to the chain of this engine on the calling thread,
+    // returns false if the calling thread is not handling its events
+    inline bool chain(T event);
+    // Block until an event arrives or stall() is called
+    void wait();
+
+    // Queued event with the index of its reply slot, if any
+    struct Item{
+        T event;
+        std::uint32_t reply;
+    };
+    static constexpr std::uint32_t noReply = ~std::uint32_t(0);
+    // Upper bound of batch(), the batch is dequeued onto the stack
+    static constexpr std::size_t maxBatch = 256;
+
+    // Returns false if the engine is stalled and event was dropped
+    inline bool push(T event, std::uint32_t reply);
+    // Put back n dequeued items, or release their requests once stalled
+    void requeue(Item* items, std::size_t n);
+
     std::atomic_bool run_;
-    BlockingQueue<T> events_;
+    std::atomic<std::size_t> batch_;
+    std::atomic<std::uint64_t> processed_;
+    std::atomic<std::size_t> chainLimit_;
+    using Trace = detail::evtTracePart<(P & evtTraced) != 0>;
+    detail::evtJournalPart<T, (P & evtJournaled) != 0> journal_;
+    detail::evtSharedPart<T, (P & evtShared) != 0> source_;
+    using Replies = detail::evtReplyPart<T, (P & evtReplies) != 0>;
+    Replies replies_;
+    BlockingQueue<Item, Trace> events_;
 };
 
-template<typename T>
-EventEngine<T>::EventEngine(std::size_t capacity):
-    events_(capacity){
+template<typename T, unsigned P>
+EventEngine<T, P>::EventEngine(std::size_t capacity, std::size_t replies):
+    run_(true), batch_(1), processed_(0), chainLimit_(1024), replies_(replies), events_(capacity){
 }
 
-template<typename T>
-template<typename F>
-void EventEngine<T>::ignite(F* cbList){
-    run_ = true;
+template<typename T, unsigned P>
+template<typename D, typename E>
+void EventEngine<T, P>::loop(D dispatch, E finish){
+    // The whole loop runs on an engine thread: events finish() emits are
+    // continuations as well, and never block on a full queue
+    Link link(this);
     while(run_){
-        T event;
-        while(events_.tryDequeue(event)){
-            cbList[event]();
+        drain(dispatch, SIZE_MAX, []{return false;});
+        finish();
+        processed_.fetch_add(unwind(dispatch, link.chain), std::memory_order_relaxed);
+        wait();
+    }
+}
+
+template<typename T, unsigned P>
+typename EventEngine<T, P>::Continuations& EventEngine<T, P>::buffer(std::size_t level){
+    if(buffers_.size() == level){
+        buffers_.emplace_back();
+    }
+    // Left over if a handler threw during the last unwind()
+    buffers_[level].clear();
+    return buffers_[level];
+}
+
+template<typename T, unsigned P>
+EventEngine<T, P>::Link::Link(EventEngine<T, P>* engine):
+    chain{engine, buffer(chain_ == nullptr ? 0 : chain_->level + 1), 0, 0, chain_,
+          chain_ == nullptr ? 0 : chain_->level + 1}{
+    chain_ = &chain;
+}
+
+template<typename T, unsigned P>
+EventEngine<T, P>::Link::~Link(){
+    chain_ = chain.outer;
+}
+
+template<typename T, unsigned P>
+template<typename D, typename X>
+std::size_t EventEngine<T, P>::drain(D& dispatch, std::size_t max, X expired){
+    Link link(this);
+    Chain& chain = link.chain;
+
+    Item items[maxBatch];
+    std::size_t handled = 0;
+    while(handled < max){
+        std::size_t count = batch_.load(std::memory_order_relaxed);
+        count = count < max - handled ? count : max - handled;
+        count = events_.tryDequeue(items, count);
+        if(count == 0){
+            break;
+        }
+        // Put back the rest of the batch if a handler throws
+        struct Rest{
+            EventEngine<T, P>& engine;
+            Item* items;
+            std::size_t next;
+            std::size_t count;
+            ~Rest(){
+                if(next != count){
+                    engine.requeue(items + next, count - next);
+                }
+            }
+        } rest{*this, items, 0, count};
+        std::size_t chained = 0;
+        while(rest.next != count){
+            const Item item = items[rest.next++];
+            replies_.serve(item.reply, [&dispatch, &item]{handle(dispatch, item.event);});
+            chained += unwind(dispatch, chain);
+        }
+        processed_.fetch_add(count + chained, std::memory_order_relaxed);
+        handled += count + chained;
+        if(expired()){
+            return handled;
+        }
+    }
+    T event;
+    while(handled < max && source_.tryPop(event)){
+        handle(dispatch, event);
+        handled += 1 + unwind(dispatch, chain);
+        if(expired()){
+            break;
         }
-        events_.wait();
     }
+    return handled;
+}
+
+template<typename T, unsigned P>
+template<typename D>
+std::size_t EventEngine<T, P>::unwind(D& dispatch, Chain& chain){
+    std::size_t handled = 0;
+    // Handlers append to events, so copy each one out before handling it.
+    // Once stalled, the remaining continuations are discarded like
+    // queued events
+    for(; chain.next != chain.events.size() && run_.load(std::memory_order_relaxed);
+          ++chain.next, ++handled){
+        const std::pair<T, std::size_t> event = chain.events[chain.next];
+        chain.depth = event.second;
+        handle(dispatch, event.first);
+    }
+    chain.events.clear();
+    chain.next = 0;
+    chain.depth = 0;
+    return handled;
+}
+
+template<typename T, unsigned P>
+bool EventEngine<T, P>::chain(T event){
+    Chain* chain = chain_;
+    while(chain != nullptr && chain->engine != this){
+        chain = chain->outer;
+    }
+    if(chain == nullptr){
+        return false;
+    }
+    if(!run_.load(std::memory_order_relaxed)){
+        // Dropped, as emit() drops events once the queue is closed
+        return true;
+    }
+    journal_.record(event);
+    // Deep chains, and handlers emitting many events at once, yield to
+    // queued events
+    const std::size_t limit = chainLimit_.load(std::memory_order_relaxed);
+    if((chain->depth >= limit || chain->events.size() - chain->next >= limit) &&
+       events_.tryEnqueue(Item{event, noReply})){
+        source_.notify();
+        return true;
+    }
+    chain->events.emplace_back(event, chain->depth + 1);
+    return true;
+}
+
+template<typename T, unsigned P>
+template<typename D>
+void EventEngine<T, P>::handle(D& dispatch, T event){
+    const auto arg = static_cast<std::uint32_t>(static_cast<std::underlying_type_t<T>>(event));
+    Trace::begin(arg);
+    dispatch(event);
+    Trace::end(arg);
+}
+
+template<typename T, unsigned P>
+void EventEngine<T, P>::wait(){
+    Trace::park();
+    source_.wait([this]{return !run_ || events_.size() != 0;}, [this]{events_.wait();});
+    Trace::wake();
 }
 
-template<typename T>
+template<typename T, unsigned P>
 template<typename F>
-void EventEngine<T>::ignite(F* cbList, F onFinish){
-    run_ = true;
-    while(run_){
-        T event;
-        while(events_.tryDequeue(event)){
-            cbList[event]();
+auto EventEngine<T, P>::dispatcher(F* cbList){
+    return [cbList](T event){cbList[event]();};
+}
+
+template<typename T, unsigned P>
+template<typename F>
+auto EventEngine<T, P>::dispatcher(F* cbList, instanceType<F>& instance){
+    return [cbList, &instance](T event){(instance.*(cbList[event]))();};
+}
+
+template<typename T, unsigned P>
+template<typename... C>
+auto EventEngine<T, P>::dispatcher(const EventMap<C...>&){
+    static_assert(std::is_same<typename EventMap<C...>::event_type, T>::value,
+                  "EventMap must map events of this engine");
+    return [](T event){
+        if(auto handler = EventMap<C...>::find(event)){
+            handler();
         }
-        onFinish();
-        events_.wait();
-    }
+    };
+}
+
+template<typename T, unsigned P>
+template<typename... C>
+auto EventEngine<T, P>::dispatcher(const EventMap<C...>&,
+                                instanceType<typename EventMap<C...>::handler_type>& instance){
+    static_assert(std::is_same<typename EventMap<C...>::event_type, T>::value,
+                  "EventMap must map events of this engine");
+    return [&instance](T event){
+        if(auto handler = EventMap<C...>::find(event)){
+            (instance.*handler)();
+        }
+    };
 }
 
-template<typename T>
+template<typename T, unsigned P>
 template<typename F>
-void EventEngine<T>::ignite(F* cbList, instanceType<F>& instance){
-    run_ = true;
-    while(run_){
-        T event;
-        while(events_.tryDequeue(event)){
-            (instance.*(cbList[event]))();
+void EventEngine<T, P>::ignite(F* cbList){
+    loop(dispatcher(cbList), []{});
+}
+
+template<typename T, unsigned P>
+template<typename F>
+void EventEngine<T, P>::ignite(F* cbList, F onFinish){
+    loop(dispatcher(cbList), onFinish);
+}
+
+template<typename T, unsigned P>
+template<typename F>
+void EventEngine<T, P>::ignite(F* cbList, instanceType<F>& instance){
+    loop(dispatcher(cbList, instance), []{});
+}
+
+template<typename T, unsigned P>
+template<typename F>
+void EventEngine<T, P>::ignite(F* cbList, F onFinish, instanceType<F>& instance){
+    loop(dispatcher(cbList, instance), [onFinish, &instance]{(instance.*onFinish)();});
+}
+
+template<typename T, unsigned P>
+template<typename... C>
+void EventEngine<T, P>::ignite(const EventMap<C...>& map){
+    loop(dispatcher(map), []{});
+}
+
+template<typename T, unsigned P>
+template<typename... C>
+void EventEngine<T, P>::ignite(const EventMap<C...>& map,
+                            typename EventMap<C...>::handler_type onFinish){
+    loop(dispatcher(map), onFinish);
+}
+
+template<typename T, unsigned P>
+template<typename... C>
+void EventEngine<T, P>::ignite(const EventMap<C...>& map,
+                            instanceType<typename EventMap<C...>::handler_type>& instance){
+    loop(dispatcher(map, instance), []{});
+}
+
+template<typename T, unsigned P>
+template<typename... C>
+void EventEngine<T, P>::ignite(const EventMap<C...>& map,
+                            typename EventMap<C...>::handler_type onFinish,
+                            instanceType<typename EventMap<C...>::handler_type>& instance){
+    loop(dispatcher(map, instance), [onFinish, &instance]{(instance.*onFinish)();});
+}
+
+template<typename T, unsigned P>
+template<typename... H>
+std::size_t EventEngine<T, P>::poll(std::size_t maxEvents, H&&... handlers){
+    auto dispatch = dispatcher(handlers...);
+    return drain(dispatch, maxEvents, []{return false;});
+}
+
+template<typename T, unsigned P>
+template<typename Rep, typename Period, typename... H>
+std::size_t EventEngine<T, P>::runFor(std::chrono::duration<Rep, Period> duration, H&&... handlers){
+    const auto deadline = std::chrono::steady_clock::now() + duration;
+    auto dispatch = dispatcher(handlers...);
+    return drain(dispatch, SIZE_MAX, [deadline]{
+        return std::chrono::steady_clock::now() >= deadline;
+    });
+}
+
+template<typename T, unsigned P>
+std::size_t EventEngine<T, P>::stall(){
+    run_ = false;
+    // stop pushing new event into the queue, wakes every igniting thread
+    events_.close();
+    // Nothing handles what is still queued, release waiting emitters
+    Item items[maxBatch];
+    std::size_t discarded = 0;
+    while(std::size_t count = events_.tryDequeue(items, maxBatch)){
+        for(std::size_t i = 0; i != count; ++i){
+            replies_.drop(items[i].reply);
         }
-        events_.wait();
+        discarded += count;
     }
+    source_.notifyAll();
+    return discarded;
 }
 
-template<typename T>
-template<typename F>
-void EventEngine<T>::ignite(F* cbList, F onFinish, instanceType<F>& instance){
-    run_ = true;
-    while(run_){
-        T event;
-        while(events_.tryDequeue(event)){
-            (instance.*(cbList[event]))();
+template<typename T, unsigned P>
+void EventEngine<T, P>::emit(T event){
+    if(!chain(event)){
+        push(event, noReply);
+    }
+}
+
+template<typename T, unsigned P>
+typename EventEngine<T, P>::Replies::handle_type EventEngine<T, P>::emitWithReply(T event){
+    static_assert((P & evtReplies) != 0, "emitWithReply() requires evtReplies and evtReply.h");
+    EventReply* slot = replies_.pool.acquire();
+    const std::uint32_t index = replies_.pool.index(slot);
+    if(!push(event, index)){
+        replies_.drop(index);
+    }
+    return typename Replies::handle_type(slot);
+}
+
+template<typename T, unsigned P>
+EventReply* EventEngine<T, P>::reply(){
+    static_assert((P & evtReplies) != 0, "reply() requires evtReplies and evtReply.h");
+    return Replies::current();
+}
+
+template<typename T, unsigned P>
+bool EventEngine<T, P>::push(T event, std::uint32_t reply){
+    journal_.record(event);
+    if(!events_.enqueue(Item{event, reply})){
+        return false;
+    }
+    source_.notify();
+    return true;
+}
+
+template<typename T, unsigned P>
+void EventEngine<T, P>::requeue(Item* items, std::size_t n){
+    if(!events_.requeue(items, n)){
+        for(std::size_t i = 0; i != n; ++i){
+            replies_.drop(items[i].reply);
         }
-        (instance.*onFinish)();
-        events_.wait();
     }
 }
 
-template<typename T>
-void EventEngine<T>::stall(){
-    run_ = false;
-    // stop pushing new event into the queue
-    events_.resize(0);
-    events_.wake();
+template<typename T, unsigned P>
+void EventEngine<T, P>::batch(std::size_t n){
+    n = n > maxBatch ? maxBatch : n;
+    batch_.store(n == 0 ? 1 : n, std::memory_order_relaxed);
+}
+
+template<typename T, unsigned P>
+std::size_t EventEngine<T, P>::batch() const{
+    return batch_.load(std::memory_order_relaxed);
+}
+
+template<typename T, unsigned P>
+std::size_t EventEngine<T, P>::pending(){
+    return events_.size();
+}
+
+template<typename T, unsigned P>
+std::uint64_t EventEngine<T, P>::processed() const{
+    return processed_.load(std::memory_order_relaxed);
+}
+
+template<typename T, unsigned P>
+void EventEngine<T, P>::chainLimit(std::size_t n){
+    chainLimit_.store(n, std::memory_order_relaxed);
+}
+
+template<typename T, unsigned P>
+void EventEngine<T, P>::attach(ShmEventSource<T>* source){
+    static_assert((P & evtShared) != 0, "attach() requires evtShared and evtShm.h");
+    source_.source.store(source, std::memory_order_release);
 }
 
-template<typename T>
-void EventEngine<T>::emit(T event){
-    events_.enqueue(std::move(event));
+template<typename T, unsigned P>
+void EventEngine<T, P>::journal(EventJournal<T>* journal){
+    static_assert((P & evtJournaled) != 0, "journal() requires evtJournaled and evtJournal.h");
+    journal_.journal.store(journal, std::memory_order_release);
 }
 
 template <typename Return, typename Object, typename... Args>
@@ -0,0 +1,408 @@
+#ifndef thdevtjournal
+#define thdevtjournal
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include "evtParts.h"
+
+
+// Journal layout: the 4 byte magic "EVJ\1" followed by one record per
+// event, each a varint of the zigzagged nanoseconds since the previous
+// record and a varint of the (zigzagged, if signed) event value.
+// Records of different threads are written in batches, so timestamps are
+// only ordered within the batches of each thread.
+
+namespace detail{
+
+constexpr std::uint8_t evtJournalMagic[4] = {'E', 'V', 'J', 1};
+
+inline void evtPutVarint(std::vector<std::uint8_t>& out, std::uint64_t value){
+    while(value >= 0x80){
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+// Returns false if the varint runs past end or exceeds 64 bits
+inline bool evtGetVarint(const std::uint8_t*& pos, const std::uint8_t* end, std::uint64_t& value){
+    value = 0;
+    for(unsigned shift = 0; shift < 64; shift += 7){
+        if(pos == end){
+            return false;
+        }
+        const std::uint8_t byte = *pos++;
+        value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if((byte & 0x80) == 0){
+            return true;
+        }
+    }
+    return false;
+}
+
+inline std::uint64_t evtZigzag(std::int64_t value){
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t evtUnzigzag(std::uint64_t value){
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+template<typename T>
+std::uint64_t evtEncode(T event){
+    using U = std::underlying_type_t<T>;
+    if constexpr(std::is_signed<U>::value){
+        return evtZigzag(static_cast<U>(event));
+    }else{
+        return static_cast<U>(event);
+    }
+}
+
+template<typename T>
+T evtDecode(std::uint64_t value){
+    using U = std::underlying_type_t<T>;
+    if constexpr(std::is_signed<U>::value){
+        return static_cast<T>(static_cast<U>(evtUnzigzag(value)));
+    }else{
+        return static_cast<T>(static_cast<U>(value));
+    }
+}
+
+} // namespace detail
+
+// Records emitted events with their time into a binary journal.
+// Each producer thread appends to its own single-producer ring, so
+// record() touches no shared state beyond that ring. A background writer
+// drains the rings periodically, encodes the records and hands the bytes
+// to the sink. Attach it to an engine with EventEngine::journal().
+template<typename T>
+class EventJournal{
+    static_assert(std::is_enum<T>::value, "T must be an enum type");
+
+  public:
+    // sink: callable as sink(const iovec* blocks, int count), e.g.
+    //       fdsink or cbsink from io/outstream.h
+    // interval: period of the background writer
+    template<typename S>
+    EventJournal(S sink, std::chrono::milliseconds interval = std::chrono::milliseconds(10));
+    // Writes out everything recorded, errors of sink are discarded
+    ~EventJournal();
+
+    // Append event to the ring of the calling thread.
+    // Blocks only if the ring is full until the writer catches up
+    inline void record(T event);
+    // Write out everything recorded so far.
+    // Rethrows the exception raised by sink, if any, and clears it: records
+    // drained while it was pending are lost, later ones are written again
+    void flush();
+
+  private:
+    struct Record{
+        std::uint64_t time;
+        T event;
+    };
+
+    // Single producer, single consumer ring of one producer thread
+    struct Ring{
+        static constexpr std::size_t capacity = 1u << 10;
+        std::atomic<std::size_t> head{0};
+        std::atomic<std::size_t> tail{0};
+        // Set when the producer thread exits, the writer drops the ring
+        // once it has drained it
+        std::atomic<bool> closed{false};
+        Record records[capacity];
+    };
+
+    // Rings of the calling thread, keyed by journal serial number
+    struct Local{
+        std::vector<std::pair<std::uint64_t, std::shared_ptr<Ring> > > rings;
+        ~Local(){
+            for(auto& entry: rings){
+                entry.second->closed.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    std::function<void(const iovec*, int)> sink_;
+    std::chrono::steady_clock::time_point epoch_;
+    std::uint64_t serial_;
+    // Source of serial_, shared by the journals of every sink type
+    static inline std::atomic<std::uint64_t> serials_{0};
+
+    // Guards rings_ only, so that registering a producer never waits
+    // for the sink
+    std::mutex ringsMutex_;
+    std::vector<std::shared_ptr<Ring> > rings_;
+    // Guards the consumer side of every ring, the encoder and the sink
+    std::mutex mutex_;
+    std::vector<std::uint8_t> bytes_;
+    std::uint64_t last_;
+    std::exception_ptr error_;
+
+    std::mutex waitMutex_;
+    std::condition_variable wakeWriter_;
+    bool stop_;
+    std::thread writer_;
+
+    static inline Local& local();
+    Ring& ring();
+    // Encode and write out all committed records, mutex_ must be held.
+    // Works on a copy of rings_, so producers can register meanwhile
+    void drain();
+    void write();
+
+    EventJournal(const EventJournal&) = delete;
+    EventJournal& operator = (const EventJournal&) = delete;
+};
+
+// Feeds a recorded journal back into an engine
+template<typename T>
+class EventReplayer{
+    static_assert(std::is_enum<T>::value, "T must be an enum type");
+
+  public:
+    // data: journal of size bytes, throws std::runtime_error if malformed
+    EventReplayer(const std::uint8_t* data, std::size_t size);
+
+    // Emit every event into engine (anything with emit(T)) in time order.
+    // paced: sleep to reproduce the recorded intervals, otherwise emit as
+    //        fast as the engine accepts them
+    // Returns the time spent emitting
+    template<typename E>
+    std::chrono::nanoseconds replay(E& engine, bool paced = true) const;
+
+    // Number of recorded events
+    inline std::size_t size() const;
+    // Time between the first and the last recorded event
+    inline std::chrono::nanoseconds span() const;
+
+  private:
+    std::vector<std::pair<std::uint64_t, T> > events_;
+};
+
+template<typename T>
+template<typename S>
+EventJournal<T>::EventJournal(S sink, std::chrono::milliseconds interval):
+    sink_(std::move(sink)), epoch_(std::chrono::steady_clock::now()), last_(0), stop_(false){
+    serial_ = ++serials_;
+    bytes_.assign(detail::evtJournalMagic, detail::evtJournalMagic + 4);
+    writer_ = std::thread([this, interval]{
+        std::unique_lock<std::mutex> lk(waitMutex_);
+        while(!stop_){
+            wakeWriter_.wait_for(lk, interval);
+            lk.unlock();
+            {
+                std::lock_guard<std::mutex> guard(mutex_);
+                drain();
+            }
+            lk.lock();
+        }
+    });
+}
+
+template<typename T>
+EventJournal<T>::~EventJournal(){
+    {
+        std::lock_guard<std::mutex> lk(waitMutex_);
+        stop_ = true;
+    }
+    wakeWriter_.notify_one();
+    writer_.join();
+    try{
+        flush();
+    }catch(...){
+    }
+}
+
+template<typename T>
+typename EventJournal<T>::Local& EventJournal<T>::local(){
+    static thread_local Local rings;
+    return rings;
+}
+
+template<typename T>
+typename EventJournal<T>::Ring& EventJournal<T>::ring(){
+    auto& rings = local().rings;
+    for(auto& entry: rings){
+        if(entry.first == serial_){
+            return *entry.second;
+        }
+    }
+    // First record of this thread: drop rings of destroyed journals,
+    // which are the only remaining owners, and register a new one
+    rings.erase(std::remove_if(rings.begin(), rings.end(),
+                    [](const std::pair<std::uint64_t, std::shared_ptr<Ring> >& entry){
+                        return entry.second.use_count() == 1;
+                    }), rings.end());
+    auto created = std::make_shared<Ring>();
+    {
+        std::lock_guard<std::mutex> lk(ringsMutex_);
+        rings_.push_back(created);
+    }
+    rings.emplace_back(serial_, created);
+    return *created;
+}
+
+template<typename T>
+void EventJournal<T>::record(T event){
+    const std::uint64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::steady_clock::now() - epoch_).count();
+    Ring& r = ring();
+    const std::size_t head = r.head.load(std::memory_order_relaxed);
+    while(head - r.tail.load(std::memory_order_acquire) == Ring::capacity){
+        wakeWriter_.notify_one();
+        std::this_thread::yield();
+    }
+    r.records[head % Ring::capacity] = Record{time, event};
+    r.head.store(head + 1, std::memory_order_release);
+    // Wake the writer early when the ring is half full
+    if((head + 1) % (Ring::capacity / 2) == 0){
+        wakeWriter_.notify_one();
+    }
+}
+
+template<typename T>
+void EventJournal<T>::drain(){
+    std::vector<std::shared_ptr<Ring> > rings;
+    {
+        std::lock_guard<std::mutex> lk(ringsMutex_);
+        rings = rings_;
+    }
+    bool pruned = false;
+    for(auto& r: rings){
+        // Loaded before head: every record of a closed ring is committed
+        const bool closed = r->closed.load(std::memory_order_acquire);
+        const std::size_t head = r->head.load(std::memory_order_acquire);
+        std::size_t tail = r->tail.load(std::memory_order_relaxed);
+        for(; tail != head; ++tail){
+            const Record& rec = r->records[tail % Ring::capacity];
+            detail::evtPutVarint(bytes_, detail::evtZigzag(
+                static_cast<std::int64_t>(rec.time - last_)));
+            detail::evtPutVarint(bytes_, detail::evtEncode(rec.event));
+            last_ = rec.time;
+        }
+        r->tail.store(tail, std::memory_order_release);
+        pruned |= closed;
+    }
+    if(pruned){
+        std::lock_guard<std::mutex> lk(ringsMutex_);
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                        [](const std::shared_ptr<Ring>& r){
+                            return r->closed.load(std::memory_order_acquire) &&
+                                   r->tail.load(std::memory_order_relaxed) ==
+                                   r->head.load(std::memory_order_relaxed);
+                        }), rings_.end());
+    }
+    write();
+}
+
+template<typename T>
+void EventJournal<T>::write(){
+    if(bytes_.empty() || error_){
+        return;
+    }
+    iovec block{bytes_.data(), bytes_.size()};
+    try{
+        sink_(&block, 1);
+    }catch(...){
+        error_ = std::current_exception();
+    }
+    bytes_.clear();
+}
+
+template<typename T>
+void EventJournal<T>::flush(){
+    std::lock_guard<std::mutex> lk(mutex_);
+    drain();
+    if(error_){
+        std::exception_ptr error;
+        std::swap(error, error_);
+        std::rethrow_exception(error);
+    }
+}
+
+template<typename T>
+EventReplayer<T>::EventReplayer(const std::uint8_t* data, std::size_t size){
+    if(size < 4 || !std::equal(data, data + 4, detail::evtJournalMagic)){
+        throw std::runtime_error("Not an event journal");
+    }
+    const std::uint8_t* pos = data + 4;
+    const std::uint8_t* end = data + size;
+    std::uint64_t time = 0;
+    while(pos != end){
+        std::uint64_t delta;
+        std::uint64_t event;
+        if(!detail::evtGetVarint(pos, end, delta) || !detail::evtGetVarint(pos, end, event)){
+            throw std::runtime_error("Truncated event journal");
+        }
+        time += static_cast<std::uint64_t>(detail::evtUnzigzag(delta));
+        events_.emplace_back(time, detail::evtDecode<T>(event));
+    }
+    // Batches of different threads interleave
+    std::stable_sort(events_.begin(), events_.end(),
+        [](const std::pair<std::uint64_t, T>& a, const std::pair<std::uint64_t, T>& b){
+            return a.first < b.first;
+        });
+}
+
+template<typename T>
+template<typename E>
+std::chrono::nanoseconds EventReplayer<T>::replay(E& engine, bool paced) const{
+    const auto start = std::chrono::steady_clock::now();
+    if(paced && !events_.empty()){
+        const std::uint64_t first = events_.front().first;
+        for(const auto& ev: events_){
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(ev.first - first));
+            engine.emit(ev.second);
+        }
+    }else{
+        for(const auto& ev: events_){
+            engine.emit(ev.second);
+        }
+    }
+    return std::chrono::steady_clock::now() - start;
+}
+
+template<typename T>
+std::size_t EventReplayer<T>::size() const{
+    return events_.size();
+}
+
+template<typename T>
+std::chrono::nanoseconds EventReplayer<T>::span() const{
+    return std::chrono::nanoseconds(events_.empty() ? 0 :
+                                    events_.back().first - events_.front().first);
+}
+
+namespace detail{
+
+// Journal part of EventEngine, see evtParts.h
+template<typename T>
+struct evtJournalPart<T, true>{
+    void record(T event){
+        if(EventJournal<T>* j = journal.load(std::memory_order_acquire)){
+            j->record(event);
+        }
+    }
+
+    std::atomic<EventJournal<T>*> journal{nullptr};
+};
+
+} // namespace detail
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef thdevtmap
+#define thdevtmap
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+
+namespace detail{
+
+template<auto> struct evtTag{};
+
+} // namespace detail
+
+// One (event, handler) pair of an EventMap
+// V: enumerator of the event
+// H: function pointer or member function pointer handling V
+template<auto V, auto H>
+struct evtCase{
+    // Compared as types: GCC does not fold member pointer comparisons
+    // in constant expressions under -fsanitize=undefined
+    static_assert(!std::is_same<detail::evtTag<H>, detail::evtTag<decltype(H){}> >::value,
+                  "Every event must have a handler");
+
+    static constexpr auto event = V;
+    static constexpr auto handler = H;
+};
+
+namespace detail{
+
+inline constexpr std::uint64_t evtMix(std::uint64_t x){
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// High 64 bits of the 128 bit product a * b
+inline constexpr std::uint64_t evtMulHi(std::uint64_t a, std::uint64_t b){
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 evtU128;
+    return static_cast<std::uint64_t>((static_cast<evtU128>(a) * b) >> 64);
+#else
+    const std::uint64_t aLo = a & 0xffffffffu, aHi = a >> 32;
+    const std::uint64_t bLo = b & 0xffffffffu, bHi = b >> 32;
+    const std::uint64_t lo = aLo * bLo;
+    const std::uint64_t mid1 = aHi * bLo + (lo >> 32);
+    const std::uint64_t mid2 = aLo * bHi + (mid1 & 0xffffffffu);
+    return aHi * bHi + (mid1 >> 32) + (mid2 >> 32);
+#endif
+}
+
+// Map key into [0, n) under the given seed
+inline constexpr std::size_t evtHash(std::uint64_t key, std::uint32_t seed, std::size_t n){
+    const std::uint64_t h = evtMix(key ^ (0x9E3779B97F4A7C15ull * (seed + 1)));
+    return static_cast<std::size_t>(evtMulHi(h, n));
+}
+
+template<std::size_t N>
+constexpr bool evtUnique(const std::array<std::uint64_t, N>& keys){
+    for(std::size_t i = 0; i != N; ++i){
+        for(std::size_t j = i + 1; j != N; ++j){
+            if(keys[i] == keys[j]){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Hash and displace: keys are grouped into N buckets by evtHash(key, 0),
+// then, largest bucket first, each bucket gets the smallest seed that
+// sends all of its keys to free slots. Slots are exactly N, so the
+// resulting hash is minimal and a lookup is two hashes and a compare.
+template<std::size_t N>
+struct evtPHF{
+    // Seed of each bucket
+    std::array<std::uint32_t, N> seeds{};
+    // Slot of each key
+    std::array<std::size_t, N> slots{};
+    bool ok = false;
+};
+
+// Seeds tried per bucket before giving up
+constexpr std::uint32_t evtSeedLimit = 1u << 16;
+
+template<std::size_t N>
+constexpr evtPHF<N> evtBuild(const std::array<std::uint64_t, N>& keys){
+    evtPHF<N> phf;
+    if(!evtUnique(keys)){
+        return phf;
+    }
+
+    std::array<std::size_t, N> bucket{};
+    std::array<std::size_t, N> load{};
+    std::size_t maxLoad = 0;
+    for(std::size_t i = 0; i != N; ++i){
+        bucket[i] = evtHash(keys[i], 0, N);
+        ++load[bucket[i]];
+        maxLoad = load[bucket[i]] > maxLoad ? load[bucket[i]] : maxLoad;
+    }
+
+    std::array<bool, N> taken{};
+    // Slots tentatively claimed by the bucket being placed, marked with
+    // the current attempt so that they need not be cleared between attempts
+    std::array<std::uint64_t, N> claim{};
+    std::uint64_t attempt = 0;
+    for(std::size_t size = maxLoad; size != 0; --size){
+        for(std::size_t b = 0; b != N; ++b){
+            if(load[b] != size){
+                continue;
+            }
+            std::uint32_t seed = 1;
+            for(; seed != evtSeedLimit; ++seed){
+                ++attempt;
+                bool fits = true;
+                for(std::size_t i = 0; i != N && fits; ++i){
+                    if(bucket[i] != b){
+                        continue;
+                    }
+                    const std::size_t slot = evtHash(keys[i], seed, N);
+                    fits = !taken[slot] && claim[slot] != attempt;
+                    claim[slot] = attempt;
+                }
+                if(fits){
+                    break;
+                }
+            }
+            if(seed == evtSeedLimit){
+                return phf;
+            }
+            phf.seeds[b] = seed;
+            for(std::size_t i = 0; i != N; ++i){
+                if(bucket[i] == b){
+                    phf.slots[i] = evtHash(keys[i], seed, N);
+                    taken[phf.slots[i]] = true;
+                }
+            }
+        }
+    }
+    phf.ok = true;
+    return phf;
+}
+
+// Reorder values so that values[i] lands in slots[i]
+template<typename V, std::size_t N>
+constexpr std::array<V, N> evtPlace(const std::array<V, N>& values,
+                                    const std::array<std::size_t, N>& slots){
+    std::array<V, N> placed{};
+    for(std::size_t i = 0; i != N; ++i){
+        placed[slots[i]] = values[i];
+    }
+    return placed;
+}
+
+template<typename C, typename... Cs>
+struct evtFirst{
+    using type = C;
+};
+
+} // namespace detail
+
+// Compile-time registry of (event, handler) pairs for EventEngine::ignite().
+// Lookup goes through a minimal perfect hash built during compilation, so
+// the table holds exactly one entry per case regardless of how sparse or
+// wide the enum values are, and dispatch is O(1).
+// Duplicate events and null handlers fail to compile, but the map can not
+// tell which enumerators exist: an event without a case is only caught by
+// static_assert(contains(event)), otherwise the engine drops it at runtime.
+//
+//  using Handlers = EventMap<evtCase<Op::ping, &onPing>,
+//                            evtCase<Op::data, &onData>>;
+//  engine.ignite(Handlers{});
+template<typename... C>
+class EventMap{
+    static_assert(sizeof...(C) != 0, "EventMap needs at least one case");
+
+  public:
+    using event_type = std::remove_const_t<decltype(detail::evtFirst<C...>::type::event)>;
+    using handler_type = std::remove_const_t<decltype(detail::evtFirst<C...>::type::handler)>;
+    static constexpr std::size_t size = sizeof...(C);
+
+    static_assert(std::is_enum<event_type>::value, "Events must be enumerators");
+    static_assert((std::is_same<std::remove_const_t<decltype(C::event)>, event_type>::value && ...),
+                  "All events must be of the same enum type");
+    static_assert((std::is_same<std::remove_const_t<decltype(C::handler)>, handler_type>::value && ...),
+                  "All handlers must be of the same type");
+    static_assert(std::is_pointer<handler_type>::value ||
+                  std::is_member_function_pointer<handler_type>::value,
+                  "Handlers must be function pointers or member function pointers");
+
+    // Handler of event, nullptr if event is not registered
+    static constexpr handler_type find(event_type event);
+    // Whether event is registered, e.g. for static_assert-ing coverage
+    static constexpr bool contains(event_type event);
+
+  private:
+    static constexpr std::uint64_t key(event_type event);
+    // Only slot event can be in
+    static constexpr std::size_t slot(event_type event);
+
+    static constexpr std::array<std::uint64_t, size> keys_ = {key(C::event)...};
+    static_assert(detail::evtUnique(keys_), "Duplicate event in EventMap");
+
+    static constexpr detail::evtPHF<size> phf_ = detail::evtBuild(keys_);
+    static_assert(phf_.ok || !detail::evtUnique(keys_), "Failed to build perfect hash for EventMap");
+
+    static constexpr std::array<event_type, size> events_ =
+        detail::evtPlace(std::array<event_type, size>{C::event...}, phf_.slots);
+    static constexpr std::array<handler_type, size> handlers_ =
+        detail::evtPlace(std::array<handler_type, size>{C::handler...}, phf_.slots);
+};
+
+template<typename... C>
+constexpr std::uint64_t EventMap<C...>::key(event_type event){
+    return static_cast<std::uint64_t>(static_cast<std::underlying_type_t<event_type>>(event));
+}
+
+template<typename... C>
+constexpr std::size_t EventMap<C...>::slot(event_type event){
+    const std::uint64_t k = key(event);
+    return detail::evtHash(k, phf_.seeds[detail::evtHash(k, 0, size)], size);
+}
+
+template<typename... C>
+constexpr typename EventMap<C...>::handler_type EventMap<C...>::find(event_type event){
+    const std::size_t i = slot(event);
+    return events_[i] == event ? handlers_[i] : nullptr;
+}
+
+template<typename... C>
+constexpr bool EventMap<C...>::contains(event_type event){
+    return events_[slot(event)] == event;
+}
+
+#endif
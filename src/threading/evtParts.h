@@ -0,0 +1,101 @@
+#ifndef thdevtparts
+#define thdevtparts
+
+#include <cstddef>
+#include <cstdint>
+
+
+// Optional parts of an EventEngine, combined with | into its second
+// template argument, e.g. EventEngine<EvType, evtReplies | evtTraced>.
+// Each part lives in its own header, which must be included to enable it.
+// An engine without a part neither stores nor checks anything for it.
+enum EventPart: unsigned{
+    // emitWithReply(), see evtReply.h
+    evtReplies = 1u << 0,
+    // journal(), see evtJournal.h
+    evtJournaled = 1u << 1,
+    // attach() of a ShmEventSource, see evtShm.h
+    evtShared = 1u << 2,
+    // Tracer records of handlers, parking and blocked emitters, see tracer.h
+    evtTraced = 1u << 3
+};
+
+class ReplyHandle;
+class EventReply;
+template<typename T>
+class EventJournal;
+template<typename T>
+class ShmEventSource;
+
+namespace detail{
+
+// State and hooks of each part as used by the engine. The header of a
+// part specializes On = true; the primary templates are only declared,
+// so enabling a part without including its header fails to compile
+template<typename T, bool On>
+struct evtReplyPart;
+template<typename T, bool On>
+struct evtJournalPart;
+template<typename T, bool On>
+struct evtSharedPart;
+template<bool On>
+struct evtTracePart;
+
+template<typename T>
+struct evtReplyPart<T, false>{
+    // Declared only, so the engine compiles without evtReply.h
+    using handle_type = ReplyHandle;
+
+    evtReplyPart(std::size_t){
+    }
+    // Run handle() for an event queued with reply slot index
+    template<typename H>
+    void serve(std::uint32_t, H handle){
+        handle();
+    }
+    // Release the reply slot index of an event that is discarded
+    void drop(std::uint32_t){
+    }
+};
+
+template<typename T>
+struct evtJournalPart<T, false>{
+    void record(T){
+    }
+};
+
+template<typename T>
+struct evtSharedPart<T, false>{
+    bool tryPop(T&){
+        return false;
+    }
+    void notify(){
+    }
+    void notifyAll(){
+    }
+    // Sleep in fallback() unless a source is attached
+    template<typename P, typename W>
+    void wait(P, W fallback){
+        fallback();
+    }
+};
+
+template<>
+struct evtTracePart<false>{
+    static void begin(std::uint32_t){
+    }
+    static void end(std::uint32_t){
+    }
+    static void park(){
+    }
+    static void wake(){
+    }
+    static void blockBegin(){
+    }
+    static void blockEnd(){
+    }
+};
+
+} // namespace detail
+
+#endif
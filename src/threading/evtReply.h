@@ -0,0 +1,290 @@
+#ifndef thdevtreply
+#define thdevtreply
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "container/circFreeList.h"
+#include "evtParts.h"
+#include "futex.h"
+
+
+// Completion slots for EventEngine::emitWithReply().
+// Slots come from a fixed ReplyPool owned by the engine, so a request
+// allocates nothing. The state of a slot is a single futex word: waiters
+// spin for a while and then sleep on it, the handler completes it with one
+// atomic exchange and only enters the kernel if somebody sleeps.
+
+class ReplyPool;
+class ReplyHandle;
+class EventReply;
+
+namespace detail{
+
+// Request being handled on this thread, nullptr once it is completed or
+// while an event without one is handled
+inline thread_local EventReply* evtReplying = nullptr;
+
+} // namespace detail
+
+// Completion slot as seen by a handler, obtained by EventEngine::reply()
+class EventReply{
+  public:
+    // Publish result and wake the waiting emitter. Only the request being
+    // handled on the calling thread can be completed, and only once; the
+    // engine completes it with 0 when the handler returns without doing so
+    inline void complete(std::uint64_t result = 0);
+    // Whether complete() has been called
+    inline bool completed() const;
+
+  private:
+    friend class ReplyPool;
+    friend class ReplyHandle;
+    template<typename T, bool On>
+    friend struct detail::evtReplyPart;
+
+    enum State: std::uint32_t{
+        idle,
+        pending,
+        // pending, and the emitter sleeps on the futex
+        sleeping,
+        // pending, and the handle is gone: the handler frees the slot
+        abandoned,
+        done
+    };
+
+    std::atomic<std::uint32_t> state_{idle};
+    std::uint64_t result_ = 0;
+    ReplyPool* pool_ = nullptr;
+    // Next free slot + 1, 0 ends the free list
+    std::atomic<std::uint32_t> next_{0};
+
+    // complete() without the check of the calling thread
+    inline void finish(std::uint64_t result);
+};
+
+// Fixed set of slots on a detail::ccFreeStack, the free slots are named by
+// index + 1 and linked through next_
+class ReplyPool{
+  public:
+    // size: maximum number of requests in flight
+    ReplyPool(std::size_t size);
+
+    // Take a free slot, nullptr if there is none
+    EventReply* tryAcquire();
+    // Take a free slot, yields while there is none
+    EventReply* acquire();
+    // Return slot to the pool
+    void release(EventReply* slot);
+
+    inline std::uint32_t index(const EventReply* slot) const;
+    inline EventReply* at(std::uint32_t index) const;
+
+  private:
+    std::unique_ptr<EventReply[]> slots_;
+    detail::ccFreeStack free_;
+
+    ReplyPool(const ReplyPool&) = delete;
+    ReplyPool& operator = (const ReplyPool&) = delete;
+};
+
+// Emitter side of a request, returned by EventEngine::emitWithReply()
+class ReplyHandle{
+  public:
+    ReplyHandle();
+    ReplyHandle(EventReply* slot);
+    ReplyHandle(ReplyHandle&& other);
+    ReplyHandle& operator = (ReplyHandle&& other);
+    // Give the slot back, or leave that to the handler if it is still
+    // working on the request
+    ~ReplyHandle();
+
+    // Whether the handler has completed the request
+    inline bool ready() const;
+    // Block until the handler completes the request and return its result.
+    // Spins for spins iterations before sleeping on a futex, spinning is
+    // skipped on a single core since it only delays the handler.
+    // Must be called at most once
+    std::uint64_t wait(unsigned spins = 1u << 12);
+
+  private:
+    EventReply* slot_;
+
+    void reset();
+
+    ReplyHandle(const ReplyHandle&) = delete;
+    ReplyHandle& operator = (const ReplyHandle&) = delete;
+};
+
+void EventReply::complete(std::uint64_t result){
+    if(detail::evtReplying != this){
+        return;
+    }
+    detail::evtReplying = nullptr;
+    finish(result);
+}
+
+void EventReply::finish(std::uint64_t result){
+    result_ = result;
+    const std::uint32_t state = state_.exchange(done, std::memory_order_acq_rel);
+    if(state == sleeping){
+        futexWake(state_, 1);
+    }else if(state == abandoned){
+        pool_->release(this);
+    }
+}
+
+bool EventReply::completed() const{
+    return state_.load(std::memory_order_acquire) == done;
+}
+
+inline ReplyPool::ReplyPool(std::size_t size): slots_(new EventReply[size]), free_(size != 0 ? 1 : 0){
+    for(std::size_t i = 0; i != size; ++i){
+        slots_[i].pool_ = this;
+        slots_[i].next_.store(i + 1 == size ? 0 : static_cast<std::uint32_t>(i + 2),
+                              std::memory_order_relaxed);
+    }
+}
+
+inline EventReply* ReplyPool::tryAcquire(){
+    const std::uint32_t first = free_.pop([this](std::uint32_t top){
+        return slots_[top - 1].next_.load(std::memory_order_relaxed);
+    });
+    if(first == 0){
+        return nullptr;
+    }
+    EventReply* slot = &slots_[first - 1];
+    slot->state_.store(EventReply::pending, std::memory_order_relaxed);
+    return slot;
+}
+
+inline EventReply* ReplyPool::acquire(){
+    EventReply* slot;
+    while((slot = tryAcquire()) == nullptr){
+        std::this_thread::yield();
+    }
+    return slot;
+}
+
+inline void ReplyPool::release(EventReply* slot){
+    slot->state_.store(EventReply::idle, std::memory_order_relaxed);
+    free_.push(index(slot) + 1, [slot](std::uint32_t below){
+        slot->next_.store(below, std::memory_order_relaxed);
+    });
+}
+
+std::uint32_t ReplyPool::index(const EventReply* slot) const{
+    return static_cast<std::uint32_t>(slot - slots_.get());
+}
+
+EventReply* ReplyPool::at(std::uint32_t index) const{
+    return &slots_[index];
+}
+
+inline ReplyHandle::ReplyHandle(): slot_(nullptr){
+}
+
+inline ReplyHandle::ReplyHandle(EventReply* slot): slot_(slot){
+}
+
+inline ReplyHandle::ReplyHandle(ReplyHandle&& other): slot_(other.slot_){
+    other.slot_ = nullptr;
+}
+
+inline ReplyHandle& ReplyHandle::operator = (ReplyHandle&& other){
+    if(this != &other){
+        reset();
+        slot_ = other.slot_;
+        other.slot_ = nullptr;
+    }
+    return *this;
+}
+
+inline ReplyHandle::~ReplyHandle(){
+    reset();
+}
+
+inline void ReplyHandle::reset(){
+    if(slot_ == nullptr){
+        return;
+    }
+    std::uint32_t state = EventReply::pending;
+    if(!slot_->state_.compare_exchange_strong(state, EventReply::abandoned,
+                                              std::memory_order_acq_rel)){
+        // Already done
+        slot_->pool_->release(slot_);
+    }
+    slot_ = nullptr;
+}
+
+bool ReplyHandle::ready() const{
+    return slot_ != nullptr && slot_->completed();
+}
+
+inline std::uint64_t ReplyHandle::wait(unsigned spins){
+    static const bool multicore = std::thread::hardware_concurrency() > 1;
+    std::atomic<std::uint32_t>& state = slot_->state_;
+    spins = multicore ? spins : 0;
+    for(; spins != 0 && state.load(std::memory_order_acquire) != EventReply::done; --spins){
+    }
+    std::uint32_t expected = EventReply::pending;
+    if(state.compare_exchange_strong(expected, EventReply::sleeping, std::memory_order_acquire)){
+        expected = EventReply::sleeping;
+    }
+    while(expected == EventReply::sleeping){
+        futexWait(state, EventReply::sleeping);
+        expected = state.load(std::memory_order_acquire);
+    }
+    const std::uint64_t result = slot_->result_;
+    slot_->pool_->release(slot_);
+    slot_ = nullptr;
+    return result;
+}
+
+namespace detail{
+
+// Reply part of EventEngine, see evtParts.h
+template<typename T>
+struct evtReplyPart<T, true>{
+    using handle_type = ReplyHandle;
+
+    evtReplyPart(std::size_t size): pool(size){
+    }
+
+    template<typename H>
+    void serve(std::uint32_t index, H handle){
+        // Complete the request if the handler returns or throws without
+        // doing so, and restore the request of an enclosing handler
+        struct Serving{
+            EventReply* slot;
+            EventReply* outer;
+            ~Serving(){
+                if(slot != nullptr && evtReplying == slot){
+                    slot->finish(0);
+                }
+                evtReplying = outer;
+            }
+        } serving{index == ~std::uint32_t(0) ? nullptr : pool.at(index), evtReplying};
+        evtReplying = serving.slot;
+        handle();
+    }
+
+    // Complete the request of an event that will never be handled with 0
+    void drop(std::uint32_t index){
+        if(index != ~std::uint32_t(0)){
+            pool.at(index)->finish(0);
+        }
+    }
+
+    static EventReply* current(){
+        return evtReplying;
+    }
+
+    ReplyPool pool;
+};
+
+} // namespace detail
+
+#endif
@@ -0,0 +1,393 @@
+#ifndef thdevtshm
+#define thdevtshm
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "evtParts.h"
+#include "futex.h"
+
+
+// Bounded event ring in a named POSIX shared memory segment.
+// ShmEventSource owns the segment and is consumed by the engine it is
+// attached to (EventEngine::attach()), ShmEventEmitter opens it from any
+// process and emits into it. Producers are serialized by a robust process
+// shared mutex and publish an event by advancing head after writing it, so
+// a producer dying at any point leaves the ring consistent. Consumers
+// never lock, each claims an event with a CAS on tail, so several threads
+// may pop. Sleeping on either side is an eventcount on a futex word.
+
+namespace detail{
+
+constexpr std::uint32_t shmRingMagic = 0x45565352; // "EVSR"
+
+struct shmRingHeader{
+    std::atomic<std::uint32_t> magic;
+    std::uint32_t eventSize;
+    std::uint64_t capacity;
+    pid_t owner;
+    // Set when the source is destroyed
+    std::atomic<std::uint32_t> closed;
+    pthread_mutex_t mutex;
+
+    // Next slot to write, advanced by producers under mutex
+    alignas(64) std::atomic<std::uint64_t> head;
+    // Next slot to read, claimed by consumers with a CAS
+    alignas(64) std::atomic<std::uint64_t> tail;
+    // Eventcounts, bumped on every publish and every consume
+    alignas(64) std::atomic<std::uint32_t> published;
+    std::atomic<std::uint32_t> consumerWaiting;
+    alignas(64) std::atomic<std::uint32_t> consumed;
+    std::atomic<std::uint32_t> producersWaiting;
+};
+
+constexpr std::size_t shmRingSlots = (sizeof(shmRingHeader) + 63) / 64 * 64;
+
+inline std::size_t shmRingBytes(std::size_t capacity, std::size_t eventSize){
+    return shmRingSlots + capacity * eventSize;
+}
+
+// Bump the eventcount and wake its sleepers, if any
+inline void shmRingNotify(std::atomic<std::uint32_t>& count,
+                          std::atomic<std::uint32_t>& waiting, int sleepers){
+    count.fetch_add(1);
+    if(waiting.load() != 0){
+        futexWake(count, sleepers, true);
+    }
+}
+
+// Whether process pid has exited
+inline bool shmDead(pid_t pid){
+    return ::kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+// Unlink segment name if it is an event ring whose owner has exited and
+// close the ring for the emitters still mapping it. Returns false if the
+// segment is live or not an event ring, and it is left alone
+inline bool shmReclaim(const std::string& name){
+    int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if(fd < 0){
+        // Gone meanwhile
+        return errno == ENOENT;
+    }
+    struct stat st;
+    void* base = MAP_FAILED;
+    if(::fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= shmRingSlots){
+        base = ::mmap(nullptr, shmRingSlots, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if(base == MAP_FAILED){
+        return false;
+    }
+    shmRingHeader* header = static_cast<shmRingHeader*>(base);
+    const bool stale = header->magic.load(std::memory_order_acquire) == shmRingMagic &&
+                       shmDead(header->owner);
+    if(stale){
+        header->closed.store(1);
+        shmRingNotify(header->consumed, header->producersWaiting, INT_MAX);
+        ::shm_unlink(name.c_str());
+    }
+    ::munmap(base, shmRingSlots);
+    return stale;
+}
+
+inline void shmRingLock(shmRingHeader* header){
+    int ret = pthread_mutex_lock(&header->mutex);
+    if(ret == EOWNERDEAD){
+        // The dead producer had not advanced head, nothing to repair
+        pthread_mutex_consistent(&header->mutex);
+    }else if(ret != 0){
+        throw std::system_error(ret, std::generic_category(), "pthread_mutex_lock");
+    }
+}
+
+} // namespace detail
+
+template<typename T>
+class ShmEventSource{
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+  public:
+    // Create segment name (e.g. "/myEngine") holding capacity events.
+    // A segment of the same name is replaced only if it is an event ring
+    // whose owner process has exited, otherwise std::system_error (EEXIST)
+    // is thrown.
+    // capacity: rounded up to a power of 2
+    ShmEventSource(const std::string& name, std::size_t capacity);
+    // Unlink the segment, blocked emitters fail with std::runtime_error
+    ~ShmEventSource();
+
+    // Pop the oldest event into event, return false if there is none.
+    // May be called from several threads
+    inline bool tryPop(T& event);
+    // Block until the ring is not empty or ready() holds.
+    // ready must become true only along with a call to notify()
+    template<typename P>
+    void wait(P ready);
+    // Wake a consumer blocked in wait()
+    inline void notify();
+    // Wake every consumer blocked in wait()
+    inline void notifyAll();
+
+  private:
+    std::string name_;
+    detail::shmRingHeader* header_;
+    T* slots_;
+    std::size_t bytes_;
+
+    ShmEventSource(const ShmEventSource&) = delete;
+    ShmEventSource& operator = (const ShmEventSource&) = delete;
+};
+
+template<typename T>
+class ShmEventEmitter{
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+  public:
+    // Open segment name created by a ShmEventSource<T>
+    ShmEventEmitter(const std::string& name);
+    ~ShmEventEmitter();
+
+    // Push event, blocks while the ring is full.
+    // Throws std::runtime_error if the source is gone
+    void emit(T event);
+    // Push event if the ring is not full, return true
+    // otherwise return false without blocking
+    bool tryEmit(T event);
+
+  private:
+    detail::shmRingHeader* header_;
+    T* slots_;
+    std::size_t bytes_;
+
+    // Whether the owner of the segment has gone
+    bool orphaned() const;
+
+    ShmEventEmitter(const ShmEventEmitter&) = delete;
+    ShmEventEmitter& operator = (const ShmEventEmitter&) = delete;
+};
+
+template<typename T>
+ShmEventSource<T>::ShmEventSource(const std::string& name, std::size_t capacity): name_(name){
+    std::size_t cap = 1;
+    while(cap < capacity){
+        cap <<= 1;
+    }
+    bytes_ = detail::shmRingBytes(cap, sizeof(T));
+
+    int fd;
+    while((fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600)) < 0){
+        const int err = errno;
+        if(err != EEXIST || !detail::shmReclaim(name)){
+            throw std::system_error(err, std::generic_category(), "shm_open");
+        }
+    }
+    if(::ftruncate(fd, static_cast<off_t>(bytes_)) != 0){
+        int err = errno;
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        throw std::system_error(err, std::generic_category(), "ftruncate");
+    }
+    void* base = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int err = errno;
+    ::close(fd);
+    if(base == MAP_FAILED){
+        ::shm_unlink(name.c_str());
+        throw std::system_error(err, std::generic_category(), "mmap");
+    }
+
+    // The segment is zero filled, which is the initial state of the atomics
+    header_ = static_cast<detail::shmRingHeader*>(base);
+    slots_ = reinterpret_cast<T*>(static_cast<char*>(base) + detail::shmRingSlots);
+    header_->eventSize = sizeof(T);
+    header_->capacity = cap;
+    header_->owner = ::getpid();
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&header_->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    header_->magic.store(detail::shmRingMagic, std::memory_order_release);
+}
+
+template<typename T>
+ShmEventSource<T>::~ShmEventSource(){
+    header_->closed.store(1);
+    detail::shmRingNotify(header_->consumed, header_->producersWaiting, INT_MAX);
+    ::munmap(header_, bytes_);
+    ::shm_unlink(name_.c_str());
+}
+
+template<typename T>
+bool ShmEventSource<T>::tryPop(T& event){
+    std::uint64_t tail = header_->tail.load(std::memory_order_acquire);
+    T copy;
+    do{
+        if(tail == header_->head.load(std::memory_order_acquire)){
+            return false;
+        }
+        // Copy before claiming: once another consumer moves tail past the
+        // slot a producer may overwrite it, and the torn copy is discarded
+        // along with the failed CAS
+        copy = slots_[tail & (header_->capacity - 1)];
+    }while(!header_->tail.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel,
+                                                std::memory_order_acquire));
+    event = copy;
+    detail::shmRingNotify(header_->consumed, header_->producersWaiting, 1);
+    return true;
+}
+
+template<typename T>
+template<typename P>
+void ShmEventSource<T>::wait(P ready){
+    header_->consumerWaiting.fetch_add(1);
+    const std::uint32_t key = header_->published.load();
+    if(!ready() && header_->tail.load() == header_->head.load()){
+        futexWait(header_->published, key, nullptr, true);
+    }
+    header_->consumerWaiting.fetch_sub(1);
+}
+
+template<typename T>
+void ShmEventSource<T>::notify(){
+    detail::shmRingNotify(header_->published, header_->consumerWaiting, 1);
+}
+
+template<typename T>
+void ShmEventSource<T>::notifyAll(){
+    detail::shmRingNotify(header_->published, header_->consumerWaiting, INT_MAX);
+}
+
+template<typename T>
+ShmEventEmitter<T>::ShmEventEmitter(const std::string& name){
+    int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if(fd < 0){
+        throw std::system_error(errno, std::generic_category(), "shm_open");
+    }
+    struct stat st;
+    if(::fstat(fd, &st) != 0){
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "fstat");
+    }
+    bytes_ = static_cast<std::size_t>(st.st_size);
+    if(bytes_ < detail::shmRingSlots){
+        ::close(fd);
+        throw std::runtime_error("Shared memory segment is not an event ring");
+    }
+    void* base = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int err = errno;
+    ::close(fd);
+    if(base == MAP_FAILED){
+        throw std::system_error(err, std::generic_category(), "mmap");
+    }
+    header_ = static_cast<detail::shmRingHeader*>(base);
+    slots_ = reinterpret_cast<T*>(static_cast<char*>(base) + detail::shmRingSlots);
+    if(header_->magic.load(std::memory_order_acquire) != detail::shmRingMagic ||
+       header_->eventSize != sizeof(T) ||
+       detail::shmRingBytes(header_->capacity, sizeof(T)) > bytes_){
+        ::munmap(base, bytes_);
+        throw std::runtime_error("Shared memory segment is not an event ring of this type");
+    }
+}
+
+template<typename T>
+ShmEventEmitter<T>::~ShmEventEmitter(){
+    ::munmap(header_, bytes_);
+}
+
+template<typename T>
+bool ShmEventEmitter<T>::tryEmit(T event){
+    if(header_->closed.load() != 0){
+        throw std::runtime_error("Event source is closed");
+    }
+    detail::shmRingLock(header_);
+    const std::uint64_t head = header_->head.load(std::memory_order_relaxed);
+    if(head - header_->tail.load(std::memory_order_acquire) == header_->capacity){
+        pthread_mutex_unlock(&header_->mutex);
+        return false;
+    }
+    slots_[head & (header_->capacity - 1)] = event;
+    header_->head.store(head + 1, std::memory_order_release);
+    pthread_mutex_unlock(&header_->mutex);
+    detail::shmRingNotify(header_->published, header_->consumerWaiting, 1);
+    return true;
+}
+
+template<typename T>
+void ShmEventEmitter<T>::emit(T event){
+    // Recheck liveness of the owner periodically while the ring stays full
+    const timespec interval{0, 50 * 1000 * 1000};
+    while(!tryEmit(event)){
+        header_->producersWaiting.fetch_add(1);
+        const std::uint32_t key = header_->consumed.load();
+        bool woken = true;
+        if(header_->head.load() - header_->tail.load() == header_->capacity &&
+           header_->closed.load() == 0){
+            woken = futexWait(header_->consumed, key, &interval, true);
+        }
+        header_->producersWaiting.fetch_sub(1);
+        if(!woken && orphaned()){
+            throw std::runtime_error("Event source process is gone");
+        }
+    }
+}
+
+template<typename T>
+bool ShmEventEmitter<T>::orphaned() const{
+    return detail::shmDead(header_->owner);
+}
+
+namespace detail{
+
+// Shared memory part of EventEngine, see evtParts.h
+template<typename T>
+struct evtSharedPart<T, true>{
+    bool tryPop(T& event){
+        ShmEventSource<T>* s = source.load(std::memory_order_acquire);
+        return s != nullptr && s->tryPop(event);
+    }
+    void notify(){
+        if(ShmEventSource<T>* s = source.load(std::memory_order_acquire)){
+            s->notify();
+        }
+    }
+    void notifyAll(){
+        if(ShmEventSource<T>* s = source.load(std::memory_order_acquire)){
+            s->notifyAll();
+        }
+    }
+    // Local events and stall() notify the source as well, so its futex is
+    // the only thing to sleep on once one is attached
+    template<typename P, typename W>
+    void wait(P ready, W fallback){
+        if(ShmEventSource<T>* s = source.load(std::memory_order_acquire)){
+            s->wait(ready);
+        }else{
+            fallback();
+        }
+    }
+
+    std::atomic<ShmEventSource<T>*> source{nullptr};
+};
+
+} // namespace detail
+
+#endif
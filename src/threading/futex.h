@@ -0,0 +1,48 @@
+#ifndef thdfutex
+#define thdfutex
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+              "futex words must be plain 32 bit integers");
+
+// Thin wrappers of the futex system call.
+// shared: word may be mapped by other processes, otherwise the cheaper
+//         process private futex is used
+
+// Block while word holds expected, at most for timeout if not nullptr.
+// Returns false on timeout; spurious wakeups return true
+inline bool futexWait(std::atomic<std::uint32_t>& word, std::uint32_t expected,
+                      const timespec* timeout = nullptr, bool shared = false){
+    const int op = shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
+    if(::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), op,
+                 expected, timeout, nullptr, 0) == 0){
+        return true;
+    }
+    switch(errno){
+        case EAGAIN:
+        case EINTR:
+            return true;
+        case ETIMEDOUT:
+            return false;
+        default:
+            throw std::system_error(errno, std::generic_category(), "futex wait");
+    }
+}
+
+// Wake at most count threads blocked on word
+inline void futexWake(std::atomic<std::uint32_t>& word, int count, bool shared = false){
+    const int op = shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE;
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), op,
+              count, nullptr, nullptr, 0);
+}
+
+#endif
@@ -0,0 +1,282 @@
+#ifndef thdpipeline
+#define thdpipeline
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "evtEngine.h"
+
+
+namespace detail{
+
+// Type erased stage of a Pipeline
+class pipeStageBase{
+  public:
+    pipeStageBase(const std::string& name, std::size_t capacity, std::size_t threads):
+        name(name), capacity(capacity), threads(threads){
+    }
+    virtual ~pipeStageBase(){
+    }
+
+    virtual void run() = 0;
+    // Returns the number of queued events discarded
+    virtual std::size_t stall() = 0;
+    virtual std::size_t pending() = 0;
+    virtual std::uint64_t processed() const = 0;
+    virtual std::size_t batch() const = 0;
+    virtual void batch(std::size_t n) = 0;
+
+    const std::string name;
+    const std::size_t capacity;
+    const std::size_t threads;
+    std::vector<std::thread> workers;
+
+    // Controller state
+    std::uint64_t lastProcessed = 0;
+    double lastThroughput = 0;
+    bool growing = true;
+};
+
+template<typename T, unsigned P, typename F>
+class pipeStage: public pipeStageBase{
+  public:
+    pipeStage(const std::string& name, std::size_t capacity, std::size_t threads, F f):
+        pipeStageBase(name, capacity, threads), engine(capacity), f(f){
+    }
+
+    void run() override{
+        f(engine);
+    }
+    std::size_t stall() override{
+        return engine.stall();
+    }
+    std::size_t pending() override{
+        return engine.pending();
+    }
+    std::uint64_t processed() const override{
+        return engine.processed();
+    }
+    std::size_t batch() const override{
+        return engine.batch();
+    }
+    void batch(std::size_t n) override{
+        engine.batch(n);
+    }
+
+    EventEngine<T, P> engine;
+
+  private:
+    F f;
+};
+
+} // namespace detail
+
+// Runs a set of EventEngines (stages), each on its own threads, and tunes
+// their dequeue batch sizes. It does not connect the stages: handlers
+// hand events on by calling emit() on the next stage themselves, so a
+// full stage blocks the stage feeding it and backpressure propagates up
+// to the source through the queue capacities.
+// A controller thread samples every stage each period. Queueing delay is
+// not measured per event but estimated from the sampled depth and
+// throughput (Little's law). A stage whose estimated delay exceeds the
+// target climbs towards the batch size with the highest throughput, one
+// that keeps up halves its batch again to keep latency low.
+class Pipeline{
+  public:
+    struct Stats{
+        std::string name;
+        // Events handled per second over the last period
+        double throughput;
+        // Queued events at the end of the last period
+        std::size_t depth;
+        // Queueing delay estimated as depth / throughput (Little's law)
+        std::chrono::nanoseconds delay;
+        std::size_t batch;
+        std::uint64_t processed;
+    };
+
+    // target: queueing delay above which a stage is considered saturated
+    // period: sampling interval of the controller
+    Pipeline(std::chrono::nanoseconds target = std::chrono::milliseconds(1),
+             std::chrono::milliseconds period = std::chrono::milliseconds(100));
+    // Stops the pipeline if running
+    ~Pipeline();
+
+    // Add a stage of capacity queued events, run by threads threads each
+    // calling run(engine), which is expected to call engine.ignite().
+    // Throws std::logic_error once start() has been called.
+    // P: EventPart flags of the stage's engine
+    template<typename T, unsigned P = 0, typename F>
+    EventEngine<T, P>& stage(const std::string& name, std::size_t capacity,
+                          std::size_t threads, F run);
+
+    // Invoke f with the statistics of every stage after each period.
+    // Throws std::logic_error once start() has been called
+    void report(std::function<void(const std::vector<Stats>&)> f);
+
+    // Start the threads of every stage and the controller. A pipeline
+    // runs once: stalled engines can not be restarted, so calling start()
+    // again throws std::logic_error
+    void start();
+    // Stall every stage and join all threads. Events still queued are
+    // discarded, returns their number
+    std::size_t stop();
+
+    // Statistics of every stage as of the last period, in order of stage()
+    std::vector<Stats> stats();
+
+  private:
+    std::chrono::nanoseconds target_;
+    std::chrono::milliseconds period_;
+    std::vector<std::unique_ptr<detail::pipeStageBase> > stages_;
+    std::function<void(const std::vector<Stats>&)> report_;
+
+    std::mutex mutex_;
+    std::condition_variable stopped_;
+    bool stop_;
+    bool started_;
+    std::vector<Stats> stats_;
+    std::thread controller_;
+
+    void control();
+    // Sample stage over elapsed and adjust its batch size
+    Stats tune(detail::pipeStageBase& stage, std::chrono::nanoseconds elapsed);
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator = (const Pipeline&) = delete;
+};
+
+inline Pipeline::Pipeline(std::chrono::nanoseconds target, std::chrono::milliseconds period):
+    target_(target), period_(period), stop_(false), started_(false){
+}
+
+inline Pipeline::~Pipeline(){
+    stop();
+}
+
+template<typename T, unsigned P, typename F>
+EventEngine<T, P>& Pipeline::stage(const std::string& name, std::size_t capacity,
+                                   std::size_t threads, F run){
+    if(started_){
+        throw std::logic_error("Pipeline stages must be added before start()");
+    }
+    auto stage = std::make_unique<detail::pipeStage<T, P, F> >(name, capacity,
+                                                              threads == 0 ? 1 : threads, run);
+    EventEngine<T, P>& engine = stage->engine;
+    stages_.push_back(std::move(stage));
+    return engine;
+}
+
+inline void Pipeline::report(std::function<void(const std::vector<Stats>&)> f){
+    if(started_){
+        throw std::logic_error("Pipeline reports must be set before start()");
+    }
+    report_ = std::move(f);
+}
+
+inline void Pipeline::start(){
+    if(started_){
+        throw std::logic_error("Pipeline can only be started once");
+    }
+    started_ = true;
+    for(auto& stage: stages_){
+        for(std::size_t i = 0; i != stage->threads; ++i){
+            stage->workers.emplace_back([&stage]{stage->run();});
+        }
+    }
+    controller_ = std::thread([this]{control();});
+}
+
+inline std::size_t Pipeline::stop(){
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stop_ = true;
+    }
+    stopped_.notify_one();
+    if(controller_.joinable()){
+        controller_.join();
+    }
+    // Stalling closes every queue, so threads blocked emitting into
+    // a later stage are released as well
+    std::size_t discarded = 0;
+    for(auto& stage: stages_){
+        discarded += stage->stall();
+    }
+    for(auto& stage: stages_){
+        for(auto& worker: stage->workers){
+            worker.join();
+        }
+        stage->workers.clear();
+    }
+    return discarded;
+}
+
+inline std::vector<Pipeline::Stats> Pipeline::stats(){
+    std::lock_guard<std::mutex> lk(mutex_);
+    return stats_;
+}
+
+inline void Pipeline::control(){
+    auto last = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lk(mutex_);
+    while(!stopped_.wait_for(lk, period_, [this]{return stop_;})){
+        lk.unlock();
+        const auto now = std::chrono::steady_clock::now();
+        std::vector<Stats> stats;
+        for(auto& stage: stages_){
+            stats.push_back(tune(*stage, now - last));
+        }
+        last = now;
+        if(report_){
+            report_(stats);
+        }
+        lk.lock();
+        stats_ = std::move(stats);
+    }
+}
+
+inline Pipeline::Stats Pipeline::tune(detail::pipeStageBase& stage, std::chrono::nanoseconds elapsed){
+    Stats stats;
+    stats.name = stage.name;
+    stats.processed = stage.processed();
+    stats.depth = stage.pending();
+    stats.throughput = (stats.processed - stage.lastProcessed) /
+                       std::chrono::duration<double>(elapsed).count();
+    if(stats.throughput > 0){
+        stats.delay = std::chrono::nanoseconds(
+            static_cast<std::int64_t>(stats.depth / stats.throughput * 1e9));
+    }else{
+        stats.delay = stats.depth == 0 ? std::chrono::nanoseconds(0) : elapsed;
+    }
+
+    std::size_t batch = stage.batch();
+    if(stats.delay > target_){
+        // Saturated: keep moving while throughput improves, turn around
+        // once it drops by more than noise
+        if(stats.throughput < stage.lastThroughput * 0.98){
+            stage.growing = !stage.growing;
+        }
+        batch = stage.growing ? batch * 2 : batch / 2;
+    }else{
+        // Keeping up: smaller batches hand events on sooner
+        batch /= 2;
+        stage.growing = true;
+    }
+    batch = batch < 1 ? 1 : batch > stage.capacity ? stage.capacity : batch;
+    stage.batch(batch);
+
+    stage.lastProcessed = stats.processed;
+    stage.lastThroughput = stats.throughput;
+    stats.batch = batch;
+    return stats;
+}
+
+#endif
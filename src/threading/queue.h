@@ -4,15 +4,31 @@
 
 #include <condition_variable>
 #include <deque>
+#include <iterator>
 #include <mutex>
 
-template<typename T>
+namespace detail{
+
+// Hooks called around an enqueue blocking on a full queue
+struct queueHooks{
+    static void blockBegin(){
+    }
+    static void blockEnd(){
+    }
+};
+
+} // namespace detail
+
+// H: hooks with static blockBegin() and blockEnd(), e.g. the tracing
+//    hooks of an EventEngine
+template<typename T, typename H = detail::queueHooks>
 class BlockingQueue{
   public:
     // capacity: maximum number events in queue, pushing more is blocking
     BlockingQueue(size_t capacity);
-    // enqueue item, if queue is full this will block
-    void enqueue(T &&item);
+    // enqueue item, if queue is full this will block.
+    // return false if the queue is closed and item was dropped
+    bool enqueue(T &&item);
     // enqueue item if queue is not full, return true
     // otherwise return false without blocking
     bool tryEnqueue(T &&item);
@@ -21,12 +37,24 @@ class BlockingQueue{
     // dequeue to item if queue is not full, return true
     // otherwise return false without blocking
     bool tryDequeue(T &item);
+    // dequeue up to max items to items without blocking,
+    // return the number of items dequeued
+    std::size_t tryDequeue(T *items, std::size_t max);
+    // put n dequeued items back in front of the queue in order, even
+    // beyond capacity, return false if the queue is closed
+    bool requeue(T *items, std::size_t n);
     // wait (block) until queue is not empty or wake() is called
     void wait();
     // wake the thread from wating (blocking)
     void wake();
     // change the capacity
     void resize(std::size_t capacity);
+    // number of items in queue
+    std::size_t size();
+    // wake all waiting threads for good: wait() returns immediately and
+    // items enqueued from now on are dropped (enqueue() returns false)
+    // instead of blocking
+    void close();
 
   private:
     std::deque<T> content_;
@@ -36,6 +64,7 @@ class BlockingQueue{
     std::condition_variable notEmpty_;
     std::condition_variable notFull_;
     bool wake_;
+    bool closed_;
 
     BlockingQueue(const BlockingQueue &) = delete;
     BlockingQueue(BlockingQueue &&) = delete;
@@ -44,23 +73,31 @@ class BlockingQueue{
 
 };
 
-template<typename T>
-BlockingQueue<T>::BlockingQueue(size_t capacity): capacity_(capacity), wake_(false){
+template<typename T, typename H>
+BlockingQueue<T, H>::BlockingQueue(size_t capacity): capacity_(capacity), wake_(false), closed_(false){
 }
 
-template<typename T>
-void BlockingQueue<T>::enqueue(T &&item){
+template<typename T, typename H>
+bool BlockingQueue<T, H>::enqueue(T &&item){
     std::unique_lock<std::mutex> lk(mutex_);
-    notFull_.wait(lk, [this](){return content_.size() < capacity_;});
+    auto notFull = [this](){return content_.size() < capacity_ || closed_;};
+    if (!notFull()){
+        H::blockBegin();
+        notFull_.wait(lk, notFull);
+        H::blockEnd();
+    }
+    if (closed_)
+        return false;
     content_.push_back(std::move(item));
 
     notEmpty_.notify_one();
+    return true;
 }
 
-template<typename T>
-bool BlockingQueue<T>::tryEnqueue(T &&item){
+template<typename T, typename H>
+bool BlockingQueue<T, H>::tryEnqueue(T &&item){
     std::unique_lock<std::mutex> lk(mutex_);
-    if (content_.size() == capacity_)
+    if (content_.size() >= capacity_ || closed_)
         return false;
     content_.push_back(std::move(item));
 
@@ -68,8 +105,8 @@ bool BlockingQueue<T>::tryEnqueue(T &&item){
     return true;
 }
 
-template<typename T>
-void BlockingQueue<T>::dequeue(T &item){
+template<typename T, typename H>
+void BlockingQueue<T, H>::dequeue(T &item){
     std::unique_lock<std::mutex> lk(mutex_);
     notEmpty_.wait(lk, [this](){return !content_.empty();});
     item = std::move(content_.front());
@@ -78,8 +115,8 @@ void BlockingQueue<T>::dequeue(T &item){
     notFull_.notify_one();
 }
 
-template<typename T>
-bool BlockingQueue<T>::tryDequeue(T &item){
+template<typename T, typename H>
+bool BlockingQueue<T, H>::tryDequeue(T &item){
     std::unique_lock<std::mutex> lk(mutex_);
     if (content_.empty())
         return false;
@@ -90,25 +127,67 @@ bool BlockingQueue<T>::tryDequeue(T &item){
     return true;
 }
 
-template<typename T>
-void BlockingQueue<T>::wait(){
+template<typename T, typename H>
+std::size_t BlockingQueue<T, H>::tryDequeue(T *items, std::size_t max){
     std::unique_lock<std::mutex> lk(mutex_);
-    notEmpty_.wait(lk, [this](){return !content_.empty() || wake_;});
+    std::size_t n = content_.size() < max ? content_.size() : max;
+    for (std::size_t i = 0; i != n; ++i){
+        items[i] = std::move(content_.front());
+        content_.pop_front();
+    }
+
+    if (n == 1)
+        notFull_.notify_one();
+    else if (n > 1)
+        notFull_.notify_all();
+    return n;
+}
+
+template<typename T, typename H>
+bool BlockingQueue<T, H>::requeue(T *items, std::size_t n){
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (closed_)
+        return false;
+    content_.insert(content_.begin(), std::make_move_iterator(items),
+                    std::make_move_iterator(items + n));
+
+    notEmpty_.notify_all();
+    return true;
+}
+
+template<typename T, typename H>
+void BlockingQueue<T, H>::wait(){
+    std::unique_lock<std::mutex> lk(mutex_);
+    notEmpty_.wait(lk, [this](){return !content_.empty() || wake_ || closed_;});
     wake_ = false;
 }
 
-template<typename T>
-void BlockingQueue<T>::wake(){
+template<typename T, typename H>
+void BlockingQueue<T, H>::wake(){
     std::unique_lock<std::mutex> lk(mutex_);
     wake_ = true;
     notEmpty_.notify_one();
 }
 
-template<typename T>
-void BlockingQueue<T>::resize(std::size_t capacity){
+template<typename T, typename H>
+void BlockingQueue<T, H>::resize(std::size_t capacity){
     std::unique_lock<std::mutex> lk(mutex_);
     capacity_ = capacity;
     notFull_.notify_one();
 }
 
+template<typename T, typename H>
+std::size_t BlockingQueue<T, H>::size(){
+    std::unique_lock<std::mutex> lk(mutex_);
+    return content_.size();
+}
+
+template<typename T, typename H>
+void BlockingQueue<T, H>::close(){
+    std::unique_lock<std::mutex> lk(mutex_);
+    closed_ = true;
+    notEmpty_.notify_all();
+    notFull_.notify_all();
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,295 @@
+#ifndef thdtracer
+#define thdtracer
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "evtParts.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+// What a trace record marks
+enum class TraceKind: std::uint32_t{
+    // A handler starts and returns, arg is the event value
+    handlerBegin,
+    handlerEnd,
+    // A producer blocks on a full queue and resumes
+    blockBegin,
+    blockEnd,
+    // An engine thread goes to sleep and wakes up
+    park,
+    wake
+};
+
+// Process wide flight recorder of engine activity.
+// Each thread appends fixed size records to its own ring, overwriting the
+// oldest ones, so recording takes no lock and allocates nothing after the
+// first record of a thread. Timestamps are raw TSC reads where available.
+// Recording is off until enable(true), and costs one relaxed load then.
+// dump() converts whatever the rings hold to Chrome trace-event JSON,
+// which can be loaded into chrome://tracing or Perfetto.
+class Tracer{
+  public:
+    // Records kept per thread
+    static constexpr std::size_t capacity = 1u << 13;
+
+    static inline void enable(bool on);
+    static inline bool enabled();
+
+    // Append a record to the ring of the calling thread, if enabled
+    static inline void record(TraceKind kind, std::uint32_t arg = 0);
+    // Name the calling thread in dumps
+    static inline void name(const std::string& thread);
+
+    // Write every record still held as Chrome trace-event JSON
+    static inline void dump(std::ostream& out);
+    // Drop all records, and the rings of exited threads
+    static inline void clear();
+
+  private:
+    struct Slot{
+        std::atomic<std::uint64_t> time;
+        // kind << 32 | arg
+        std::atomic<std::uint64_t> meta;
+    };
+
+    struct Ring{
+        std::atomic<std::uint64_t> head{0};
+        // Records before this one were dropped by clear()
+        std::uint64_t floor = 0;
+        std::uint32_t tid = 0;
+        std::string name;
+        Slot slots[capacity];
+    };
+
+    struct Registry{
+        std::mutex mutex;
+        std::vector<std::shared_ptr<Ring> > rings;
+        std::uint32_t tids = 0;
+        // Clock pair taken at enable(true), to scale TSC ticks to time
+        std::uint64_t tick0 = 0;
+        std::chrono::steady_clock::time_point time0;
+    };
+
+    static inline std::atomic<bool> enabled_{false};
+    // Ring of the calling thread; the plain pointer needs no TLS guard on
+    // the recording path, the owner keeps the ring alive until thread exit
+    static inline thread_local Ring* local_ = nullptr;
+    static inline thread_local std::shared_ptr<Ring> owner_;
+
+    static inline Registry& registry();
+    static inline std::uint64_t now();
+    static inline Ring& ring();
+};
+
+void Tracer::enable(bool on){
+    if(on && !enabled_.load(std::memory_order_relaxed)){
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lk(reg.mutex);
+        reg.tick0 = now();
+        reg.time0 = std::chrono::steady_clock::now();
+    }
+    enabled_.store(on, std::memory_order_relaxed);
+}
+
+bool Tracer::enabled(){
+    return enabled_.load(std::memory_order_relaxed);
+}
+
+Tracer::Registry& Tracer::registry(){
+    static Registry reg;
+    return reg;
+}
+
+std::uint64_t Tracer::now(){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+Tracer::Ring& Tracer::ring(){
+    if(local_ == nullptr){
+        owner_ = std::make_shared<Ring>();
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lk(reg.mutex);
+        owner_->tid = ++reg.tids;
+        reg.rings.push_back(owner_);
+        local_ = owner_.get();
+    }
+    return *local_;
+}
+
+void Tracer::record(TraceKind kind, std::uint32_t arg){
+    if(!enabled_.load(std::memory_order_relaxed)){
+        return;
+    }
+    Ring& r = ring();
+    const std::uint64_t head = r.head.load(std::memory_order_relaxed);
+    Slot& slot = r.slots[head & (capacity - 1)];
+    slot.time.store(now(), std::memory_order_relaxed);
+    slot.meta.store(static_cast<std::uint64_t>(kind) << 32 | arg, std::memory_order_relaxed);
+    r.head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::name(const std::string& thread){
+    Ring& r = ring();
+    std::lock_guard<std::mutex> lk(registry().mutex);
+    r.name = thread;
+}
+
+void Tracer::dump(std::ostream& out){
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lk(reg.mutex);
+
+    // Scale ticks with the clock pair of enable(true) and one taken now
+    const std::uint64_t tick1 = now();
+    const auto time1 = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double, std::micro>(time1 - reg.time0).count();
+    const double usPerTick = tick1 != reg.tick0 ? elapsed / static_cast<double>(tick1 - reg.tick0) : 0;
+
+    const auto flags = out.flags();
+    const auto precision = out.precision(3);
+    out << std::fixed << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    auto separate = [&]{
+        if(!first){
+            out << ",\n";
+        }
+        first = false;
+    };
+    std::vector<std::pair<std::uint64_t, std::uint64_t> > records;
+    for(auto& r: reg.rings){
+        if(!r->name.empty()){
+            separate();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << r->tid
+                << ",\"args\":{\"name\":\"";
+            for(char c: r->name){
+                if(c == '"' || c == '\\'){
+                    out << '\\' << c;
+                }else if(static_cast<unsigned char>(c) < 0x20){
+                    // Control characters are not allowed in JSON strings
+                    const char* hex = "0123456789abcdef";
+                    out << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+                }else{
+                    out << c;
+                }
+            }
+            out << "\"}}";
+        }
+
+        // The owner keeps writing, so copy first and then keep only the
+        // records that cannot have been overwritten meanwhile
+        const std::uint64_t head = r->head.load(std::memory_order_acquire);
+        std::uint64_t begin = head > capacity ? head - capacity : 0;
+        begin = std::max(begin, std::min(r->floor, head));
+        records.clear();
+        for(std::uint64_t i = begin; i != head; ++i){
+            const Slot& slot = r->slots[i & (capacity - 1)];
+            records.emplace_back(slot.time.load(std::memory_order_relaxed),
+                                 slot.meta.load(std::memory_order_relaxed));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const std::uint64_t after = r->head.load(std::memory_order_relaxed);
+        const std::uint64_t valid = after >= capacity ? after - capacity + 1 : 0;
+        const std::size_t skip = static_cast<std::size_t>(
+                                    valid > begin ? std::min(valid - begin, head - begin) : 0);
+
+        // The oldest records held may end slices whose begin was
+        // overwritten or cleared, those are left out to keep B/E matched
+        std::size_t open = 0;
+        for(std::size_t i = skip; i != records.size(); ++i){
+            const std::uint64_t tick = records[i].first;
+            const auto kind = static_cast<TraceKind>(records[i].second >> 32);
+            const std::uint32_t arg = static_cast<std::uint32_t>(records[i].second);
+            if(kind == TraceKind::handlerBegin || kind == TraceKind::blockBegin ||
+               kind == TraceKind::park){
+                ++open;
+            }else if(open == 0){
+                continue;
+            }else{
+                --open;
+            }
+            // Records from before the last enable(true) come out negative
+            const double ts = (static_cast<double>(tick) - static_cast<double>(reg.tick0)) * usPerTick;
+            separate();
+            out << "{\"pid\":1,\"tid\":" << r->tid << ",\"ts\":" << ts << ',';
+            switch(kind){
+                case TraceKind::handlerBegin:
+                    out << "\"ph\":\"B\",\"name\":\"event " << arg << "\"}";
+                    break;
+                case TraceKind::handlerEnd:
+                    out << "\"ph\":\"E\",\"name\":\"event " << arg << "\"}";
+                    break;
+                case TraceKind::blockBegin:
+                    out << "\"ph\":\"B\",\"name\":\"enqueue blocked\"}";
+                    break;
+                case TraceKind::blockEnd:
+                    out << "\"ph\":\"E\",\"name\":\"enqueue blocked\"}";
+                    break;
+                case TraceKind::park:
+                    out << "\"ph\":\"B\",\"name\":\"parked\"}";
+                    break;
+                case TraceKind::wake:
+                    out << "\"ph\":\"E\",\"name\":\"parked\"}";
+                    break;
+            }
+        }
+    }
+    out << "]}\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void Tracer::clear(){
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lk(reg.mutex);
+    // The owner thread holds the other reference of a live ring
+    reg.rings.erase(std::remove_if(reg.rings.begin(), reg.rings.end(),
+                        [](const std::shared_ptr<Ring>& r){return r.use_count() == 1;}),
+                    reg.rings.end());
+    for(auto& r: reg.rings){
+        r->floor = r->head.load(std::memory_order_acquire);
+    }
+}
+
+namespace detail{
+
+// Tracing part of EventEngine, see evtParts.h
+template<>
+struct evtTracePart<true>{
+    static void begin(std::uint32_t event){
+        Tracer::record(TraceKind::handlerBegin, event);
+    }
+    static void end(std::uint32_t event){
+        Tracer::record(TraceKind::handlerEnd, event);
+    }
+    static void park(){
+        Tracer::record(TraceKind::park);
+    }
+    static void wake(){
+        Tracer::record(TraceKind::wake);
+    }
+    static void blockBegin(){
+        Tracer::record(TraceKind::blockBegin);
+    }
+    static void blockEnd(){
+        Tracer::record(TraceKind::blockEnd);
+    }
+};
+
+} // namespace detail
+
+#endif
@@ -0,0 +1,60 @@
+#include <cassert>
+#include <iostream>
+
+#include "container/circAlgo.h"
+
+template<typename L>
+void check(const L& list, long size){
+    const long sum = par_transform_reduce(list, 0L, [](long a, long b){return a + b;},
+                                          [](int x){return static_cast<long>(x);}, 8);
+    assert(sum == size * (size - 1) / 2);
+    par_for_each(list, [](int& x){x *= 2;}, 8);
+    for(long i = 0; i < size; i += size / 7 + 1){
+        auto found = par_find_if(list, [i](int x){return x == 2 * i;}, 8);
+        assert(found != typename L::iterator() && *found == 2 * i);
+    }
+    assert(par_find_if(list, [](int x){return x % 2 != 0;}, 8) == typename L::iterator());
+}
+
+template<typename L>
+void fill(L& list, int size){
+    for(int i = 0; i != size; ++i){
+        list.push_back(i);
+    }
+}
+
+int main(){
+    // Empty lists call nothing
+    ccList<int> empty;
+    ccIdxList<int> emptyIdx;
+    bool called = false;
+    par_for_each(empty, [&](int&){called = true;}, 8);
+    par_for_each(emptyIdx, [&](int&){called = true;}, 8);
+    assert(!called);
+    assert(par_transform_reduce(empty, 7L, [](long a, long b){return a + b;},
+                                [](int x){return static_cast<long>(x);}) == 7);
+    assert(par_find_if(emptyIdx, [](int){return true;}) == ccIdxList<int>::iterator());
+
+    // Fewer elements than threads, and enough to split
+    for(int size: {1, 3, 100000}){
+        ccList<int> list;
+        ccIdxList<int> idx;
+        fill(list, size);
+        fill(idx, size);
+        check(list, size);
+        check(idx, size);
+
+        // ccBuf::init(begin, end) needs two elements at least
+        if(size < 2){
+            continue;
+        }
+        std::vector<int> values(size);
+        for(int i = 0; i != size; ++i){
+            values[i] = i;
+        }
+        ccBuf<int> buf(size);
+        buf.init(values.begin(), values.end());
+        check(buf, size);
+    }
+    std::cout << "circAlgo passed" << std::endl;
+}
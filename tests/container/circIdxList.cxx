@@ -0,0 +1,43 @@
+#include <cassert>
+#include <iostream>
+#include <type_traits>
+
+#include "container/circIdxList.h"
+
+// Mutators of the ccList base must not be reachable, they would bypass the index
+template<typename L, typename = void>
+struct basePushable: std::false_type{};
+template<typename L>
+struct basePushable<L, decltype(static_cast<void>(
+                        static_cast<ccList<int>&>(std::declval<L&>()).push_back(0)))>:
+    std::true_type{};
+
+int main(){
+    static_assert(!basePushable<ccIdxList<int, 4> >::value, "ccList base is accessible");
+
+    ccIdxList<int, 4> list;
+    assert(list.size() == 0);
+    assert(list.begin() == list.end());
+    ccIdxList<int, 4>::iterator empty(list, 5);
+    assert(empty == list.begin());
+    assert(empty.advance(3) == list.begin());
+
+    const int n = 37;
+    for(int i = 0; i != n; ++i){
+        list.push_back(i);
+    }
+    assert(list.front() == 0 && list.back() == n - 1);
+    assert(*list.end() == n - 1);
+    for(int offset = 0; offset != 2 * n; ++offset){
+        ccIdxList<int, 4>::iterator it(list, offset);
+        assert(*it == offset % n);
+        assert(it.position() == static_cast<std::size_t>(offset % n));
+        for(int step = 0; step < n; step += 5){
+            ccIdxList<int, 4>::iterator to = it;
+            to.advance(step);
+            assert(*to == (offset + step) % n);
+            assert(it.distance(to) == static_cast<std::size_t>(step));
+        }
+    }
+    std::cout << "circIdxList passed" << std::endl;
+}
@@ -0,0 +1,122 @@
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "container/circPool.h"
+
+struct Item{
+    Item(std::size_t owner, bool fail = false): owner(owner){
+        if(fail){
+            throw std::runtime_error("construction failed");
+        }
+        ++alive;
+    }
+    ~Item(){
+        --alive;
+    }
+
+    std::size_t owner;
+    static inline std::atomic<int> alive{0};
+};
+
+constexpr std::size_t slots = 64;
+
+// Every slot can be checked out once, a throwing constructor keeps its slot
+template<typename P>
+void exhaust(P& pool){
+    std::vector<Item*> items;
+    while(Item* item = pool.acquire(items.size())){
+        items.push_back(item);
+    }
+    assert(items.size() == slots);
+    assert(pool.used() == slots);
+    for(std::size_t i = 0; i != items.size(); ++i){
+        assert(items[i]->owner == i);
+    }
+    pool.release(items.back());
+    items.pop_back();
+    bool threw = false;
+    try{
+        pool.acquire(0, true);
+    }catch(const std::runtime_error&){
+        threw = true;
+    }
+    assert(threw);
+    items.push_back(pool.acquire(0));
+    assert(items.back() != nullptr);
+    for(Item* item: items){
+        pool.release(item);
+    }
+    assert(pool.used() == 0);
+    assert(Item::alive == 0);
+}
+
+// Direct access to the shared free list
+struct Shared{
+    Shared(ccAtomicPool<Item>& pool): pool(pool){
+    }
+    template<typename... Args>
+    Item* acquire(Args&&... args){
+        return pool.acquire(std::forward<Args>(args)...);
+    }
+    void release(Item* item){
+        pool.release(item);
+    }
+
+    ccAtomicPool<Item>& pool;
+};
+
+// Small caches, so that they compete for the slots
+struct Cached: ccAtomicPool<Item>::cache{
+    Cached(ccAtomicPool<Item>& pool): ccAtomicPool<Item>::cache(pool, 8){
+    }
+};
+
+// Threads checking slots out through S and back in never share one.
+// Run under -fsanitize=thread to check the free list for races
+template<typename S>
+void stress(ccAtomicPool<Item>& pool, std::size_t threads){
+    constexpr std::size_t rounds = 20000;
+    std::vector<std::thread> workers;
+    for(std::size_t t = 0; t != threads; ++t){
+        workers.emplace_back([&pool, t]{
+            S source(pool);
+            std::vector<Item*> held;
+            for(std::size_t r = 0; r != rounds; ++r){
+                if(Item* item = source.acquire(t)){
+                    held.push_back(item);
+                }
+                if(held.size() > r % 7){
+                    assert(held.back()->owner == t);
+                    source.release(held.back());
+                    held.pop_back();
+                }
+            }
+            for(Item* item: held){
+                assert(item->owner == t);
+                source.release(item);
+            }
+        });
+    }
+    for(auto& worker: workers){
+        worker.join();
+    }
+    assert(pool.used() == 0);
+    assert(Item::alive == 0);
+}
+
+int main(){
+    ccPool<Item> pool(slots);
+    exhaust(pool);
+    ccAtomicPool<Item> shared(slots);
+    exhaust(shared);
+
+    stress<Shared>(shared, 8);
+    exhaust(shared);
+    stress<Cached>(shared, 8);
+    exhaust(shared);
+    std::cout << "circPool passed" << std::endl;
+}
@@ -0,0 +1,139 @@
+#include <cassert>
+#include <iostream>
+#include <list>
+#include <vector>
+
+#include "io/inbuf.h"
+#include "io/outbuf.h"
+
+template <bitorder O>
+void roundtrip(){
+    bcbuf<64, O> buf;
+    const bool flags[11] = {1, 0, 1, 1, 0, 0, 1, 0, 1, 1, 1};
+    buf.write(true);
+    buf.write(0x2au, 6);
+    buf.write(flags, flags + 11);
+    buf.write(0x0123456789abcdefu, 64);
+
+    bcreader<O> in(buf.data().data(), (buf.bits() + 7) / 8);
+    assert(in.read());
+    assert(in.read(6) == 0x2au);
+    for(bool flag: flags){
+        assert(in.read() == flag);
+    }
+    assert(in.peek(64) == 0x0123456789abcdefu);
+    in.skip(64);
+    assert(in.tell() == buf.bits());
+}
+
+// vector<uint8_t> iterators take the same path as pointers
+template <bitorder O>
+void contiguous(){
+    std::vector<std::uint8_t> bits(67);
+    for(std::size_t i = 0; i != bits.size(); ++i){
+        bits[i] = (i * 7 + 3) % 5 < 2;
+    }
+    bcbuf<64, O> fromPointer;
+    bcbuf<64, O> fromIterator;
+    fromPointer.write(bits.data(), bits.data() + bits.size());
+    fromIterator.write(bits.begin(), bits.end());
+    fromIterator.write(bits.begin(), bits.begin());
+    assert(fromPointer.bits() == fromIterator.bits());
+    assert(fromPointer.data() == fromIterator.data());
+}
+
+// Bits of input written one at a time, every group of 8 reversed if
+// reverse, a trailing group of n < 8 reversed within its n bits
+template <typename B>
+void naive(B& buf, const std::vector<std::uint8_t>& input, bool reverse){
+    for(std::size_t group = 0; group < input.size(); group += 8){
+        const std::size_t n = input.size() - group < 8 ? input.size() - group : 8;
+        for(std::size_t i = 0; i != n; ++i){
+            buf.write(input[group + (reverse ? n - 1 - i : i)] != 0);
+        }
+    }
+}
+
+// The vectorized path (pointers, vector iterators) and the scalar one (list
+// iterators) write the same bits as naive(), after prefixes of any length
+// and for tails that are not a multiple of 8
+template <bitorder O>
+void paths(){
+    std::vector<std::uint8_t> source(400);
+    for(std::size_t i = 0; i != source.size(); ++i){
+        // Any nonzero byte is a set bit
+        source[i] = (i * 11 + 5) % 7 < 3 ? static_cast<std::uint8_t>(1u << (i % 8)) : 0;
+    }
+    for(bool reverse: {false, true}){
+        for(std::size_t prefix = 0; prefix != 10; ++prefix){
+            for(std::size_t size: {0, 1, 7, 8, 9, 15, 63, 64, 65, 127, 129, 255, 257, 300, 391}){
+                // Odd source offsets make the packed loads unaligned
+                const std::size_t offset = (prefix * 3) % 8;
+                const std::uint8_t* first = source.data() + offset;
+                const std::vector<std::uint8_t> input(first, first + size);
+                const std::list<std::uint8_t> listed(input.begin(), input.end());
+
+                bcbuf<128, O> expected, pointer, iterator, scalar;
+                for(auto* buf: {&expected, &pointer, &iterator, &scalar}){
+                    buf->write(0x2d5u, static_cast<unsigned>(prefix + 1));
+                }
+                naive(expected, input, reverse);
+                if(reverse){
+                    pointer.write_reverse(first, first + size);
+                    iterator.write_reverse(input.begin(), input.end());
+                    scalar.write_reverse(listed.begin(), listed.end());
+                }else{
+                    pointer.write(first, first + size);
+                    iterator.write(input.begin(), input.end());
+                    scalar.write(listed.begin(), listed.end());
+                }
+                for(auto* buf: {&pointer, &iterator, &scalar}){
+                    assert(buf->bits() == expected.bits());
+                    assert(buf->data() == expected.data());
+                }
+            }
+        }
+    }
+}
+
+// Every packing kernel the CPU supports matches the scalar one
+void kernels(){
+    std::vector<std::uint8_t> source(8 * 80 + 3);
+    for(std::size_t i = 0; i != source.size(); ++i){
+        source[i] = (i * 13 + 1) % 5 < 2 ? static_cast<std::uint8_t>(0xff - i % 3) : 0;
+    }
+    std::vector<detail::bcpackers> packers{{detail::bcpack_swar, detail::bcpackr_swar}};
+#ifdef BCIO_X86
+    if(detail::bccpu().sse2){
+        packers.push_back({detail::bcpack_sse2, detail::bcpackr_sse2});
+    }
+    if(detail::bccpu().avx2){
+        packers.push_back({detail::bcpack_avx2, detail::bcpackr_avx2});
+    }
+#endif
+    for(std::size_t offset = 0; offset != 4; ++offset){
+        for(std::size_t n = 0; n != 80; ++n){
+            std::vector<std::uint8_t> forward(n + 1, 0x5a), backward(n + 1, 0x5a);
+            detail::bcpack_swar(source.data() + offset, n, forward.data());
+            detail::bcpackr_swar(source.data() + offset, n, backward.data());
+            for(const auto& packer: packers){
+                std::vector<std::uint8_t> out(n + 1, 0x5a);
+                packer.pack(source.data() + offset, n, out.data());
+                assert(out == forward);
+                packer.packr(source.data() + offset, n, out.data());
+                assert(out == backward);
+            }
+        }
+    }
+}
+
+int main(){
+    roundtrip<bitorder::lsb>();
+    roundtrip<bitorder::msb>();
+    contiguous<bitorder::lsb>();
+    contiguous<bitorder::msb>();
+    paths<bitorder::lsb>();
+    paths<bitorder::msb>();
+    kernels();
+    std::cout << "bitio passed" << std::endl;
+}
@@ -0,0 +1,167 @@
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "io/bitrank.h"
+
+// Pseudo random bytes with roughly density/256 of the bits set
+std::vector<std::uint8_t> random(std::size_t size, unsigned density, std::uint64_t seed){
+    std::vector<std::uint8_t> bytes(size);
+    for(auto& byte: bytes){
+        for(unsigned bit = 0; bit != 8; ++bit){
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            if((seed >> 56) < density){
+                byte |= static_cast<std::uint8_t>(1u << bit);
+            }
+        }
+    }
+    return bytes;
+}
+
+template <bitorder O>
+bool naiveTest(const std::vector<std::uint8_t>& bytes, std::size_t i){
+    const unsigned shift = O == bitorder::lsb ? i % 8 : 7 - i % 8;
+    return (bytes[i / 8] >> shift) & 1u;
+}
+
+// rank, select and test agree with a scan over every position
+template <bitorder O>
+void scan(const std::vector<std::uint8_t>& bytes, std::size_t nbits){
+    bcrank<O> index(bytes.data(), nbits);
+    assert(index.size() == nbits);
+    std::size_t ones = 0;
+    for(std::size_t i = 0; i != nbits; ++i){
+        assert(index.rank(i) == ones);
+        const bool set = naiveTest<O>(bytes, i);
+        assert(index.test(i) == set);
+        if(set){
+            assert(index.select(ones) == i);
+            ++ones;
+        }
+    }
+    assert(index.rank(nbits) == ones);
+    assert(index.ones() == ones);
+    assert(index.select(ones) == nbits);
+    assert(index.select(ones + 100) == nbits);
+}
+
+template <bitorder O>
+void rankSelect(){
+    // Bits past nbits in the last byte are set and must be ignored
+    const std::vector<std::uint8_t> full(1024, 0xff);
+    for(std::size_t nbits: {0, 1, 7, 63, 65, 511, 513, 4095, 4097, 8191}){
+        scan<O>(full, nbits);
+    }
+    // Sparse, dense and odd lengths over several superblocks
+    const std::vector<std::uint8_t> sparse = random(3000, 3, 1);
+    const std::vector<std::uint8_t> dense = random(3000, 200, 2);
+    scan<O>(sparse, 3000 * 8);
+    scan<O>(sparse, 3000 * 8 - 13);
+    scan<O>(dense, 3000 * 8 - 1);
+    // All zeros: nothing to select
+    const std::vector<std::uint8_t> zeros(100, 0);
+    scan<O>(zeros, 799);
+
+    // Over 8192 set bits per sample, select lands on both sides of every
+    // sample boundary
+    const std::vector<std::uint8_t> many = random(40000, 128, 3);
+    const std::size_t nbits = 40000 * 8 - 5;
+    bcrank<O> index(many.data(), nbits);
+    assert(index.ones() > 3 * 8192);
+    std::vector<std::size_t> positions;
+    for(std::size_t i = 0; i != nbits; ++i){
+        if(naiveTest<O>(many, i)){
+            positions.push_back(i);
+        }
+    }
+    assert(index.ones() == positions.size());
+    for(std::size_t sample = 8192; sample < positions.size(); sample += 8192){
+        for(std::size_t k = sample - 3; k != sample + 3; ++k){
+            assert(index.select(k) == positions[k]);
+            assert(index.rank(positions[k]) == k);
+            assert(index.rank(positions[k] + 1) == k + 1);
+        }
+    }
+}
+
+// Every kernel matches the scalar one, over lengths around the vector
+// widths and unaligned starts
+void kernels(){
+    const std::vector<std::uint8_t> a = random(200, 100, 4);
+    const std::vector<std::uint8_t> b = random(200, 150, 5);
+    std::vector<detail::bcbulk> paths{
+        {detail::bcones_swar, detail::bccount_swar, detail::bcand_swar, detail::bcor_swar}
+    };
+#ifdef BCIO_X86
+    const detail::bcisa& cpu = detail::bccpu();
+    if(cpu.sse2){
+        paths.push_back({detail::bcones_swar, detail::bccount_swar,
+                         detail::bcand_sse2, detail::bcor_sse2});
+    }
+    if(cpu.popcnt){
+        paths.push_back({detail::bcones_popcnt, detail::bccount_popcnt,
+                         detail::bcand_sse2, detail::bcor_sse2});
+    }
+    if(cpu.avx2 && cpu.popcnt){
+        paths.push_back({detail::bcones_popcnt, detail::bccount_avx2,
+                         detail::bcand_avx2, detail::bcor_avx2});
+    }
+#endif
+    for(const detail::bcbulk& path: paths){
+        for(std::size_t offset = 0; offset != 3; ++offset){
+            for(std::size_t size = 0; size != 100; ++size){
+                const std::uint8_t* x = a.data() + offset;
+                const std::uint8_t* y = b.data() + offset;
+                std::size_t expected = 0;
+                for(std::size_t i = 0; i != size; ++i){
+                    expected += detail::bcones_swar(x[i]);
+                }
+                assert(path.count(x, size) == expected);
+
+                std::vector<std::uint8_t> conj(size + 1, 0x55), disj(size + 1, 0x55);
+                path.conj(conj.data(), x, y, size);
+                path.disj(disj.data(), x, y, size);
+                for(std::size_t i = 0; i != size; ++i){
+                    assert(conj[i] == (x[i] & y[i]));
+                    assert(disj[i] == (x[i] | y[i]));
+                }
+                // Nothing written past size
+                assert(conj[size] == 0x55 && disj[size] == 0x55);
+            }
+        }
+        for(std::uint64_t w: {0ull, 1ull, 0x8000000000000000ull, ~0ull, 0x0123456789abcdefull}){
+            assert(path.ones(w) == detail::bcones_swar(w));
+        }
+    }
+
+    // The selected kernels, in place as well
+    std::vector<std::uint8_t> dst(a);
+    bcand(dst.data(), dst.data(), b.data(), dst.size());
+    for(std::size_t i = 0; i != dst.size(); ++i){
+        assert(dst[i] == (a[i] & b[i]));
+    }
+    bcor(dst.data(), a.data(), dst.data(), dst.size());
+    assert(dst == a);
+    assert(bcpopcount(a.data(), a.size()) == paths.front().count(a.data(), a.size()));
+}
+
+// bcselect64 against clearing the lowest set bit r times
+void select64(){
+    for(std::uint64_t w: {1ull, 0x8000000000000000ull, ~0ull, 0x0123456789abcdefull,
+                          0xf000000000000001ull, 0x0000010000100000ull}){
+        std::uint64_t rest = w;
+        for(unsigned r = 0; rest != 0; ++r){
+            assert(detail::bcselect64(w, r) == detail::bcctz64(rest));
+            rest &= rest - 1;
+        }
+    }
+}
+
+int main(){
+    rankSelect<bitorder::lsb>();
+    rankSelect<bitorder::msb>();
+    kernels();
+    select64();
+    std::cout << "bitrank passed" << std::endl;
+}
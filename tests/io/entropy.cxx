@@ -0,0 +1,153 @@
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "io/entropy.h"
+#include "io/inbuf.h"
+#include "io/outbuf.h"
+
+template <bitorder O>
+void roundtrip(){
+    const std::vector<std::uint64_t> unsignedValues = {
+        0, 1, 2, 3, 254, 255, 256, 0xffffffffu, std::uint64_t(1) << 32,
+        std::numeric_limits<std::uint64_t>::max() - 1, std::numeric_limits<std::uint64_t>::max()};
+    const std::vector<std::int64_t> signedValues = {
+        0, 1, -1, 2, -2, 1000, -1000,
+        std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::min(),
+        std::numeric_limits<std::int64_t>::min() + 1};
+    const std::vector<std::uint64_t> freq = {50, 20, 0, 10, 10, 5, 3, 2};
+    const huffman<O> code(freq);
+
+    bcbuf<4096, O> buf;
+    for(auto v: unsignedValues){
+        writeUE(buf, v);
+    }
+    for(auto v: signedValues){
+        writeSE(buf, v);
+    }
+    for(unsigned k: {0u, 3u, 17u}){
+        for(std::uint64_t v = 0; v < 200; v += 7){
+            writeRice(buf, v, k);
+        }
+    }
+    for(std::size_t s = 0; s != freq.size(); ++s){
+        if(freq[s] != 0){
+            code.encode(buf, s);
+        }
+    }
+
+    bcreader<O> in(buf.data().data(), (buf.bits() + 7) / 8);
+    for(auto v: unsignedValues){
+        assert(readUE(in) == v);
+    }
+    for(auto v: signedValues){
+        assert(readSE(in) == v);
+    }
+    for(unsigned k: {0u, 3u, 17u}){
+        for(std::uint64_t v = 0; v < 200; v += 7){
+            assert(readRice(in, k) == v);
+        }
+    }
+    const huffman<O> decoder(code.lengths());
+    for(std::size_t s = 0; s != freq.size(); ++s){
+        if(freq[s] != 0){
+            assert(decoder.decode(in) == s);
+        }
+    }
+    assert(in.tell() == buf.bits());
+}
+
+// Fibonacci frequencies give a plain Huffman tree as deep as the alphabet,
+// so lengths have to be limited to M
+template <bitorder O, unsigned M>
+void limited(std::size_t symbols){
+    std::vector<std::uint64_t> freq(symbols);
+    std::uint64_t a = 1, b = 1;
+    for(auto& f: freq){
+        f = a;
+        a = b;
+        b += f;
+    }
+    // A symbol without a code in the middle
+    freq[symbols / 2] = 0;
+    const huffman<O, M> code(freq);
+
+    std::uint64_t kraft = 0;
+    std::size_t longest = 0;
+    for(std::size_t s = 0; s != symbols; ++s){
+        const std::size_t l = code.lengths()[s];
+        assert((l == 0) == (freq[s] == 0));
+        assert(l <= M);
+        longest = l > longest ? l : longest;
+        kraft += l ? std::uint64_t(1) << (M - l) : 0;
+        // More frequent symbols never get longer codes
+        if(s != 0 && freq[s] != 0 && freq[s - 1] != 0){
+            assert(l <= code.lengths()[s - 1]);
+        }
+    }
+    assert(longest == M);
+    assert(kraft <= std::uint64_t(1) << M);
+
+    bcbuf<4096, O> buf;
+    for(std::size_t round = 0; round != 3; ++round){
+        for(std::size_t s = 0; s != symbols; ++s){
+            if(freq[s] != 0){
+                code.encode(buf, s);
+            }
+        }
+    }
+    const huffman<O, M> decoder(code.lengths());
+    bcreader<O> in(buf.data().data(), (buf.bits() + 7) / 8);
+    for(std::size_t round = 0; round != 3; ++round){
+        for(std::size_t s = 0; s != symbols; ++s){
+            if(freq[s] != 0){
+                assert(decoder.decode(in) == s);
+            }
+        }
+    }
+    assert(in.tell() == buf.bits());
+}
+
+// Rice quotients far beyond a single 64 bit peek
+template <bitorder O>
+void longRuns(){
+    auto buf = std::make_unique<bcbuf<1u << 16, O> >();
+    for(std::uint64_t v: {std::uint64_t(0), std::uint64_t(64) << 2, std::uint64_t(100003) << 2 | 3}){
+        writeRice(*buf, v, 2);
+    }
+    writeUE(*buf, 5);
+    bcreader<O> in(buf->data().data(), (buf->bits() + 7) / 8);
+    assert(readRice(in, 2) == 0);
+    assert(readRice(in, 2) == std::uint64_t(64) << 2);
+    assert(readRice(in, 2) == (std::uint64_t(100003) << 2 | 3));
+    assert(readUE(in) == 5);
+    assert(in.tell() == buf->bits());
+}
+
+// se(v) keeps the H.264 mapping 0 1 -1 2 -2 -> 0 1 2 3 4
+void mapping(){
+    bcbuf<64, bitorder::msb> buf;
+    for(std::int64_t v: {0, 1, -1, 2, -2}){
+        writeSE(buf, v);
+    }
+    bcreader<bitorder::msb> in(buf.data().data(), (buf.bits() + 7) / 8);
+    for(std::uint64_t u = 0; u != 5; ++u){
+        assert(readUE(in) == u);
+    }
+}
+
+int main(){
+    roundtrip<bitorder::lsb>();
+    roundtrip<bitorder::msb>();
+    limited<bitorder::lsb, 12>(40);
+    limited<bitorder::msb, 12>(40);
+    limited<bitorder::lsb, 6>(50);
+    limited<bitorder::msb, 5>(32);
+    longRuns<bitorder::lsb>();
+    longRuns<bitorder::msb>();
+    mapping();
+    std::cout << "entropy passed" << std::endl;
+}
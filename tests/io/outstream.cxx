@@ -0,0 +1,184 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "io/outstream.h"
+
+using bytes = std::vector<std::uint8_t>;
+
+// Sink appending every block to out
+struct collect{
+    bytes* out;
+    void operator()(const std::uint8_t* data, std::size_t size){
+        out->insert(out->end(), data, data + size);
+    }
+};
+
+// Write the same mix of fields, bits and ranges to any bit sink
+template <typename B>
+void script(B& b){
+    std::vector<std::uint8_t> range(45);
+    for(std::size_t i = 0; i != range.size(); ++i){
+        range[i] = (i * 5 + 1) % 3 == 0;
+    }
+    const std::list<bool> listed(range.begin(), range.end());
+    for(unsigned round = 0; round != 40; ++round){
+        b.write(round & 1u ? true : false);
+        b.write(0x0123456789abcdefu ^ round, 1 + round % 64);
+        b.write(range.data(), range.data() + 3 + round % 40);
+        b.write_reverse(range.begin() + round % 5, range.end());
+        b.write_reverse(listed.begin(), listed.end());
+        b.write(listed.begin(), listed.end());
+        b.write(round * 977u, 17);
+    }
+}
+
+// Output of script() written to one large bcbuf
+template <bitorder O>
+bytes reference(){
+    auto buf = std::make_unique<bcbuf<1u << 16, O> >();
+    script(*buf);
+    return bytes(buf->data().begin(), buf->data().begin() + (buf->bits() + 7) / 8);
+}
+
+// Small blocks split fields and ranges at every possible offset, and both
+// flushing modes produce the same bytes as a single buffer
+template <bitorder O, std::size_t L>
+void split(){
+    const bytes expected = reference<O>();
+    for(bool background: {false, true}){
+        bytes out;
+        std::size_t bits;
+        {
+            bcstream<L, cbsink<collect>, 3, O> stream(makeSink(collect{&out}), background);
+            script(stream);
+            stream.flush();
+            bits = stream.bits();
+        }
+        assert(bits == expected.size() * 8);
+        assert(out == expected);
+    }
+}
+
+// A throwing sink surfaces in flush() (background) or in the write that
+// fills a block (synchronous), and the stream keeps working afterwards
+void sinkError(){
+    for(bool background: {false, true}){
+        int calls = 0;
+        auto failing = makeSink([&calls](const std::uint8_t*, std::size_t){
+            if(++calls == 1){
+                throw std::runtime_error("sink failed");
+            }
+        });
+        bcstream<8, decltype(failing), 2> stream(failing, background);
+        bool threw = false;
+        try{
+            stream.write(0xffffffffffffffffu, 64);
+            stream.flush();
+        }catch(const std::runtime_error&){
+            threw = true;
+        }
+        assert(threw);
+        stream.write(0x5au, 8);
+        stream.flush();
+        assert(calls == 2);
+    }
+
+    // Errors of writev are thrown as std::system_error
+    int fds[2];
+    assert(pipe(fds) == 0);
+    close(fds[0]);
+    std::signal(SIGPIPE, SIG_IGN);
+    bcstream<8, fdsink, 2> stream(fdsink(fds[1]), true);
+    stream.write(0x5au, 8);
+    bool threw = false;
+    try{
+        stream.flush();
+    }catch(const std::system_error& e){
+        threw = e.code() == std::errc::broken_pipe;
+    }
+    assert(threw);
+    close(fds[1]);
+}
+
+std::atomic<int> interrupts{0};
+
+void onAlarm(int){
+    ++interrupts;
+}
+
+// fdsink resumes after short writes and EINTR: a timer interrupts writev
+// into a pipe that a slow reader drains. The reader starts late, so writev
+// also blocks on a full pipe before writing anything and fails with EINTR
+void interrupted(){
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onAlarm;
+    // No SA_RESTART, so writev returns early
+    sigaction(SIGALRM, &sa, nullptr);
+
+    int fds[2];
+    assert(pipe(fds) == 0);
+    bytes data(1u << 22);
+    for(std::size_t i = 0; i != data.size(); ++i){
+        data[i] = static_cast<std::uint8_t>(i * 131 + (i >> 11));
+    }
+
+    // Only the writing thread takes the signal
+    sigset_t alarm;
+    sigemptyset(&alarm);
+    sigaddset(&alarm, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &alarm, nullptr);
+    bytes received;
+    std::thread reader([&received, fd = fds[0]]{
+        std::uint8_t chunk[4096];
+        ssize_t n;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        while((n = read(fd, chunk, sizeof(chunk))) > 0){
+            received.insert(received.end(), chunk, chunk + n);
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+    });
+    pthread_sigmask(SIG_UNBLOCK, &alarm, nullptr);
+
+    itimerval timer{{0, 500}, {0, 500}};
+    setitimer(ITIMER_REAL, &timer, nullptr);
+    // 20 blocks: more than one writev of 16
+    std::vector<iovec> blocks;
+    const std::size_t block = data.size() / 20;
+    for(std::size_t i = 0; i != 20; ++i){
+        blocks.push_back(iovec{data.data() + i * block, i + 1 != 20 ? block : data.size() - i * block});
+    }
+    fdsink sink(fds[1]);
+    sink(blocks.data(), static_cast<int>(blocks.size()));
+    itimerval off{{0, 0}, {0, 0}};
+    setitimer(ITIMER_REAL, &off, nullptr);
+    close(fds[1]);
+    reader.join();
+    close(fds[0]);
+    assert(interrupts != 0);
+    assert(received == data);
+}
+
+int main(){
+    split<bitorder::lsb, 8>();
+    split<bitorder::msb, 8>();
+    split<bitorder::lsb, 13>();
+    split<bitorder::msb, 13>();
+    sinkError();
+    interrupted();
+    std::cout << "outstream passed" << std::endl;
+}
@@ -0,0 +1,140 @@
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "evtEngine.h"
+
+enum Ev{fan, leaf, deep, mark, stop};
+
+EventEngine<Ev>* engine;
+std::vector<Ev> order;
+std::atomic<int> leaves{0};
+std::atomic<bool> finished{false};
+int depth = 0;
+
+std::array<void(*)(), 5> cbs{
+    []{
+        order.push_back(fan);
+        for(int i = 0; i != 100; ++i){
+            engine->emit(leaf);
+        }
+    },
+    []{
+        order.push_back(leaf);
+        ++leaves;
+    },
+    []{
+        if(++depth != 100){
+            engine->emit(deep);
+        }
+    },
+    []{
+        order.push_back(mark);
+        finished = true;
+    },
+    []{
+        engine->stall();
+        engine->emit(leaf);
+    }
+};
+
+// Continuations run in emission order, before the next queued event
+void continuations(){
+    EventEngine<Ev> ev(8);
+    engine = &ev;
+    order.clear();
+    ev.chainLimit(1000);
+    ev.emit(fan);
+    ev.emit(mark);
+    assert(ev.poll(1000, cbs.data()) == 102);
+    assert(order.size() == 102 && order.front() == fan && order.back() == mark);
+    for(std::size_t i = 1; i != 101; ++i){
+        assert(order[i] == leaf);
+    }
+    assert(ev.processed() == 102);
+}
+
+// A handler fanning out beyond chainLimit() hands the rest to the queue
+void breadth(){
+    EventEngine<Ev> ev(1000);
+    engine = &ev;
+    ev.chainLimit(10);
+    ev.emit(fan);
+    assert(ev.poll(1, cbs.data()) == 11);
+    assert(ev.pending() == 90);
+    assert(ev.poll(1000, cbs.data()) == 90);
+}
+
+// A chain deeper than chainLimit() goes through the queue
+void depthLimit(){
+    EventEngine<Ev> ev(8);
+    engine = &ev;
+    ev.chainLimit(10);
+    depth = 0;
+    ev.emit(deep);
+    assert(ev.poll(1, cbs.data()) == 11);
+    assert(ev.pending() == 1);
+    std::size_t handled = 0;
+    while(depth != 100){
+        handled += ev.poll(1, cbs.data());
+    }
+    assert(handled == 89);
+}
+
+// Once stalled, continuations are dropped
+void stalled(){
+    EventEngine<Ev> ev(8);
+    engine = &ev;
+    leaves = 0;
+    ev.emit(stop);
+    assert(ev.poll(8, cbs.data()) == 1);
+    assert(leaves == 0);
+}
+
+// A handler, or the completion callback, emitting to its own full queue
+// does not deadlock the only thread handling it
+void fullQueue(){
+    constexpr int produced = 1000;
+    EventEngine<Ev> ev(1);
+    engine = &ev;
+    order.clear();
+    leaves = 0;
+    finished = false;
+    std::thread producer([&ev]{
+        for(int i = 0; i != produced; ++i){
+            ev.emit(leaf);
+        }
+    });
+    static std::atomic<bool> emitted{false};
+    emitted = false;
+    void (*onFinish)() = []{
+        if(!emitted){
+            // Wait for the producer to fill the queue again
+            while(engine->pending() == 0){
+                std::this_thread::yield();
+            }
+            emitted = true;
+            engine->emit(fan);
+            engine->emit(mark);
+        }
+    };
+    std::thread igniter([&ev, onFinish]{ev.ignite(cbs.data(), onFinish);});
+    producer.join();
+    while(!finished || leaves != produced + 100){
+        std::this_thread::yield();
+    }
+    ev.stall();
+    igniter.join();
+}
+
+int main(){
+    continuations();
+    breadth();
+    depthLimit();
+    stalled();
+    fullQueue();
+    std::cout << "evtChain passed" << std::endl;
+}
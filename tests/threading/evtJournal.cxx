@@ -0,0 +1,100 @@
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "evtJournal.h"
+
+enum Ev: std::uint32_t{first, second, third};
+
+// Counts replayed events per value
+struct Counter{
+    void emit(Ev event){
+        ++counts[event];
+    }
+    std::size_t counts[3] = {0, 0, 0};
+};
+
+// Journals with distinct sink types keep their records apart
+void separate(){
+    std::vector<std::uint8_t> a, b;
+    {
+        EventJournal<Ev> ja([&a](const iovec* blocks, int count){
+            for(int i = 0; i != count; ++i){
+                auto data = static_cast<const std::uint8_t*>(blocks[i].iov_base);
+                a.insert(a.end(), data, data + blocks[i].iov_len);
+            }
+        });
+        EventJournal<Ev> jb([&b](const iovec* blocks, int count){
+            for(int i = 0; i != count; ++i){
+                auto data = static_cast<const std::uint8_t*>(blocks[i].iov_base);
+                b.insert(b.end(), data, data + blocks[i].iov_len);
+            }
+        });
+        ja.record(first);
+        ja.record(first);
+        jb.record(second);
+        jb.record(second);
+        jb.record(second);
+    }
+    EventReplayer<Ev> ra(a.data(), a.size());
+    EventReplayer<Ev> rb(b.data(), b.size());
+    assert(ra.size() == 2 && rb.size() == 3);
+    Counter ca, cb;
+    ra.replay(ca, false);
+    rb.replay(cb, false);
+    assert(ca.counts[first] == 2 && ca.counts[second] == 0);
+    assert(cb.counts[second] == 3 && cb.counts[first] == 0);
+}
+
+// Several threads record into two journals at once, more than a ring holds
+void threads(){
+    constexpr std::size_t producers = 4;
+    constexpr std::size_t perThread = 5000;
+    std::vector<std::uint8_t> a, b;
+    auto sink = [](std::vector<std::uint8_t>& out){
+        return [&out](const iovec* blocks, int count){
+            for(int i = 0; i != count; ++i){
+                auto data = static_cast<const std::uint8_t*>(blocks[i].iov_base);
+                out.insert(out.end(), data, data + blocks[i].iov_len);
+            }
+        };
+    };
+    EventJournal<Ev> ja(sink(a), std::chrono::milliseconds(1));
+    EventJournal<Ev> jb(sink(b), std::chrono::milliseconds(1));
+    std::vector<std::thread> workers;
+    for(std::size_t t = 0; t != producers; ++t){
+        workers.emplace_back([&ja, &jb]{
+            for(std::size_t i = 0; i != perThread; ++i){
+                ja.record(first);
+                jb.record(third);
+                if(i % 2 == 0){
+                    jb.record(second);
+                }
+            }
+        });
+    }
+    for(auto& worker: workers){
+        worker.join();
+    }
+    ja.flush();
+    jb.flush();
+
+    EventReplayer<Ev> ra(a.data(), a.size());
+    EventReplayer<Ev> rb(b.data(), b.size());
+    Counter ca, cb;
+    ra.replay(ca, false);
+    rb.replay(cb, false);
+    assert(ca.counts[first] == producers * perThread);
+    assert(ca.counts[second] == 0 && ca.counts[third] == 0);
+    assert(cb.counts[third] == producers * perThread);
+    assert(cb.counts[second] == producers * perThread / 2);
+    assert(cb.counts[first] == 0);
+}
+
+int main(){
+    separate();
+    threads();
+    std::cout << "evtJournal passed" << std::endl;
+}
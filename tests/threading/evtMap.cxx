@@ -0,0 +1,126 @@
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+
+#include "evtEngine.h"
+#include "evtMap.h"
+
+// Sparse and wide, including a negative one
+enum class Op: std::int64_t{ping = 0x01, data = 0x40, close = 0x8000, huge = 1ll << 40, neg = -7, unknown = 3};
+
+int calls[5];
+
+void onPing(){++calls[0];}
+void onData(){++calls[1];}
+void onClose(){++calls[2];}
+void onHuge(){++calls[3];}
+void onNeg(){++calls[4];}
+
+using Handlers = EventMap<
+    evtCase<Op::ping,  &onPing>,
+    evtCase<Op::data,  &onData>,
+    evtCase<Op::close, &onClose>,
+    evtCase<Op::huge,  &onHuge>,
+    evtCase<Op::neg,   &onNeg>
+>;
+
+static_assert(Handlers::size == 5, "");
+static_assert(Handlers::contains(Op::ping) && Handlers::contains(Op::neg), "");
+static_assert(!Handlers::contains(Op::unknown), "");
+
+#ifdef EVTMAP_REJECT_DUPLICATE
+// Must not compile: "Duplicate event in EventMap"
+static_assert(EventMap<evtCase<Op::ping, &onPing>, evtCase<Op::ping, &onData> >::size == 2, "");
+#endif
+
+#ifdef EVTMAP_REJECT_NULL
+// Must not compile: "Every event must have a handler"
+static_assert(EventMap<evtCase<Op::ping, static_cast<void(*)()>(nullptr)> >::size == 1, "");
+#endif
+
+// Lookup of registered and unregistered events
+void lookup(){
+    assert(Handlers::find(Op::ping) == &onPing);
+    assert(Handlers::find(Op::data) == &onData);
+    assert(Handlers::find(Op::close) == &onClose);
+    assert(Handlers::find(Op::huge) == &onHuge);
+    assert(Handlers::find(Op::neg) == &onNeg);
+    assert(Handlers::find(Op::unknown) == nullptr);
+    assert(Handlers::find(static_cast<Op>(0x8001)) == nullptr);
+}
+
+// Events reach their handlers, events without one are dropped
+void dispatch(){
+    EventEngine<Op> ev(16);
+    for(Op op: {Op::ping, Op::huge, Op::unknown, Op::neg, Op::data, Op::close, Op::ping}){
+        ev.emit(op);
+    }
+    assert(ev.poll(16, Handlers{}) == 7);
+    assert(calls[0] == 2 && calls[1] == 1 && calls[2] == 1 && calls[3] == 1 && calls[4] == 1);
+    assert(ev.pending() == 0);
+}
+
+struct Session{
+    void onPing(){pings += 1;}
+    void onClose(){closed = true;}
+    int pings = 0;
+    bool closed = false;
+};
+
+using Members = EventMap<
+    evtCase<Op::ping,  &Session::onPing>,
+    evtCase<Op::close, &Session::onClose>
+>;
+
+// Member function maps are called on the instance
+void members(){
+    assert(Members::find(Op::data) == nullptr);
+    Session session;
+    EventEngine<Op> ev(8);
+    ev.emit(Op::ping);
+    ev.emit(Op::data);
+    ev.emit(Op::ping);
+    ev.emit(Op::close);
+    assert(ev.poll(8, Members{}, session) == 4);
+    assert(session.pings == 2 && session.closed);
+}
+
+// Many keys spread over the whole range still get a minimal perfect hash
+enum class Wide: std::uint64_t{};
+
+int hits[64];
+
+template<std::size_t I>
+void onWide(){
+    ++hits[I];
+}
+
+constexpr Wide wide(std::size_t i){
+    return static_cast<Wide>((i + 1) * 0x9E3779B97F4A7C15ull);
+}
+
+template<std::size_t... I>
+void many(std::index_sequence<I...>){
+    using Map = EventMap<evtCase<wide(I), &onWide<I> >...>;
+    EventEngine<Wide> ev(128);
+    for(std::size_t i = 0; i != sizeof...(I); ++i){
+        assert(Map::contains(wide(i)));
+        assert(!Map::contains(static_cast<Wide>(static_cast<std::uint64_t>(wide(i)) + 1)));
+        for(std::size_t n = 0; n <= i % 3; ++n){
+            ev.emit(wide(i));
+        }
+    }
+    ev.poll(128, Map{});
+    for(std::size_t i = 0; i != sizeof...(I); ++i){
+        assert(hits[i] == static_cast<int>(i % 3 + 1));
+    }
+}
+
+int main(){
+    lookup();
+    dispatch();
+    members();
+    many(std::make_index_sequence<64>{});
+    std::cout << "evtMap passed" << std::endl;
+}
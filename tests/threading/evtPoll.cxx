@@ -0,0 +1,161 @@
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include "evtEngine.h"
+
+// Allocations made by the calling thread
+thread_local std::size_t allocations = 0;
+
+void* operator new(std::size_t size){
+    ++allocations;
+    if(void* p = std::malloc(size)){
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept{
+    std::free(p);
+}
+
+enum Ev{count, slow, fail};
+
+using clk = std::chrono::steady_clock;
+
+std::atomic<std::size_t> counted{0};
+
+std::array<void(*)(), 3> cbs{
+    []{
+        counted.fetch_add(1, std::memory_order_relaxed);
+    },
+    []{
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    },
+    []{
+        throw std::runtime_error("handler failed");
+    }
+};
+
+// Nothing queued: both return at once without handling anything
+void empty(){
+    EventEngine<Ev> ev(8);
+    assert(ev.poll(16, cbs.data()) == 0);
+    const auto t0 = clk::now();
+    assert(ev.runFor(std::chrono::seconds(10), cbs.data()) == 0);
+    assert(clk::now() - t0 < std::chrono::seconds(1));
+    assert(ev.processed() == 0);
+}
+
+// poll() handles at most maxEvents
+void bounded(){
+    EventEngine<Ev> ev(8);
+    ev.batch(4);
+    for(int i = 0; i != 6; ++i){
+        ev.emit(count);
+    }
+    assert(ev.poll(5, cbs.data()) == 5);
+    assert(ev.pending() == 1);
+    assert(ev.poll(5, cbs.data()) == 1);
+    assert(ev.processed() == 6);
+}
+
+// A throwing handler leaves the rest of its batch queued, in order
+void thrown(){
+    EventEngine<Ev> ev(8);
+    ev.batch(4);
+    counted = 0;
+    ev.emit(count);
+    ev.emit(fail);
+    ev.emit(count);
+    ev.emit(count);
+    ev.emit(fail);
+    bool threw = false;
+    try{
+        ev.poll(8, cbs.data());
+    }catch(const std::runtime_error&){
+        threw = true;
+    }
+    assert(threw && counted == 1);
+    assert(ev.pending() == 3);
+    threw = false;
+    try{
+        ev.poll(8, cbs.data());
+    }catch(const std::runtime_error&){
+        threw = true;
+    }
+    assert(threw && counted == 3);
+    assert(ev.pending() == 0);
+}
+
+// runFor() stops within a batch of its deadline
+void timeout(){
+    constexpr std::size_t queued = 200;
+    EventEngine<Ev> ev(queued);
+    for(std::size_t i = 0; i != queued; ++i){
+        ev.emit(slow);
+    }
+    const auto t0 = clk::now();
+    const std::size_t handled = ev.runFor(std::chrono::milliseconds(20), cbs.data());
+    const auto elapsed = clk::now() - t0;
+    assert(elapsed >= std::chrono::milliseconds(20));
+    // One 1 ms handler past the deadline, plus scheduling slack
+    assert(elapsed < std::chrono::milliseconds(20 + 50));
+    assert(handled >= 1 && handled <= 20);
+    assert(ev.pending() == queued - handled);
+}
+
+// poll() shares the queue with ignite(): every event is handled once,
+// and polling allocates nothing once warm
+void concurrent(){
+    constexpr std::size_t emitted = 100000;
+    EventEngine<Ev> ev(64);
+    ev.batch(8);
+    counted = 0;
+    std::thread igniter([&ev]{ev.ignite(cbs.data());});
+    std::atomic<bool> done{false};
+    std::size_t polled = 0;
+    std::size_t polledAllocations = 0;
+    std::thread poller([&]{
+        // The first poll() sets up the continuation buffer of this thread
+        ev.poll(0, cbs.data());
+        const std::size_t before = allocations;
+        while(!done.load()){
+            polled += ev.poll(16, cbs.data());
+        }
+        polledAllocations = allocations - before;
+    });
+    for(std::size_t i = 0; i != emitted; ++i){
+        ev.emit(count);
+    }
+    while(counted.load() != emitted){
+        std::this_thread::yield();
+    }
+    done = true;
+    poller.join();
+    ev.stall();
+    igniter.join();
+    assert(counted.load() == emitted);
+    assert(ev.processed() == emitted);
+    assert(polled <= emitted);
+    assert(polledAllocations == 0);
+}
+
+int main(){
+    empty();
+    bounded();
+    thrown();
+    timeout();
+    concurrent();
+    std::cout << "evtPoll passed" << std::endl;
+}
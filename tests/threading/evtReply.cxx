@@ -0,0 +1,142 @@
+#include <array>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include "evtEngine.h"
+#include "evtReply.h"
+
+enum Ev{square, fail, nested, halt};
+
+using Engine = EventEngine<Ev, evtReplies>;
+
+Engine* inner;
+Engine* halting;
+std::uint64_t arg = 0;
+
+std::array<void(*)(), 4> innerCbs{
+    []{},
+    []{},
+    []{},
+    []{}
+};
+
+std::array<void(*)(), 4> cbs{
+    []{
+        Engine::reply()->complete(arg * arg);
+    },
+    []{
+        throw std::runtime_error("handler failed");
+    },
+    []{
+        // Serving a request of another engine must not end this one
+        inner->poll(1, innerCbs.data());
+        assert(Engine::reply() != nullptr);
+        Engine::reply()->complete(7);
+    },
+    []{
+        halting->stall();
+        throw std::runtime_error("handler failed");
+    }
+};
+
+// Requests are completed by the handler or when it returns
+void served(){
+    Engine ev(8, 2);
+    std::thread t([&ev]{ev.ignite(cbs.data());});
+    for(arg = 0; arg != 100; ++arg){
+        assert(ev.emitWithReply(square).wait() == arg * arg);
+    }
+    ev.stall();
+    t.join();
+}
+
+// A throwing handler completes its request and leaves no request behind
+void thrown(){
+    Engine ev(8, 1);
+    ReplyHandle handle = ev.emitWithReply(fail);
+    bool threw = false;
+    try{
+        ev.poll(1, cbs.data());
+    }catch(const std::runtime_error&){
+        threw = true;
+    }
+    assert(threw);
+    assert(handle.ready());
+    assert(Engine::reply() == nullptr);
+    assert(handle.wait() == 0);
+    // The slot was returned to the pool
+    ReplyHandle next = ev.emitWithReply(fail);
+    ev.stall();
+    assert(next.wait() == 0);
+}
+
+// Requests dequeued in the batch of a throwing handler still complete
+void thrownBatch(){
+    Engine ev(8, 4);
+    ev.batch(4);
+    ReplyHandle failed = ev.emitWithReply(fail);
+    arg = 3;
+    ReplyHandle after = ev.emitWithReply(square);
+    bool threw = false;
+    try{
+        ev.poll(8, cbs.data());
+    }catch(const std::runtime_error&){
+        threw = true;
+    }
+    assert(threw);
+    assert(failed.wait() == 0);
+    assert(!after.ready() && ev.pending() == 1);
+    assert(ev.poll(8, cbs.data()) == 1);
+    assert(after.wait() == 9);
+
+    // The rest of the batch can not be put back once the engine is
+    // stalled, so its requests complete with 0
+    halting = &ev;
+    ev.emitWithReply(halt);
+    ReplyHandle dropped = ev.emitWithReply(square);
+    threw = false;
+    try{
+        ev.poll(8, cbs.data());
+    }catch(const std::runtime_error&){
+        threw = true;
+    }
+    assert(threw);
+    assert(dropped.wait() == 0);
+    assert(ev.pending() == 0);
+}
+
+// An enclosing request survives a nested one
+void nesting(){
+    Engine ev(8, 1);
+    Engine other(8, 1);
+    inner = &other;
+    ReplyHandle innerHandle = other.emitWithReply(square);
+    ReplyHandle handle = ev.emitWithReply(nested);
+    assert(ev.poll(1, cbs.data()) == 1);
+    assert(innerHandle.wait() == 0);
+    assert(handle.wait() == 7);
+}
+
+// Requests queued at or emitted after stall() do not hang
+void stalled(){
+    Engine ev(8, 2);
+    ReplyHandle queued = ev.emitWithReply(square);
+    ev.stall();
+    assert(queued.wait() == 0);
+    // Slots are not leaked: more requests than slots
+    for(int i = 0; i != 10; ++i){
+        assert(ev.emitWithReply(square).wait() == 0);
+    }
+    assert(ev.pending() == 0);
+}
+
+int main(){
+    served();
+    thrown();
+    thrownBatch();
+    nesting();
+    stalled();
+    std::cout << "evtReply passed" << std::endl;
+}
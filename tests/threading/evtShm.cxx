@@ -0,0 +1,143 @@
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+
+#include "evtShm.h"
+
+enum Ev: std::uint32_t{first, second, third};
+
+const char* name = "/evtShmTest";
+
+// Map the header of the segment as a peer process would
+detail::shmRingHeader* mapHeader(){
+    int fd = shm_open(name, O_RDWR, 0);
+    assert(fd >= 0);
+    void* base = mmap(nullptr, detail::shmRingSlots, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    assert(base != MAP_FAILED);
+    return static_cast<detail::shmRingHeader*>(base);
+}
+
+// A live source cannot be replaced
+void liveOwner(){
+    ShmEventSource<Ev> source(name, 4);
+    bool refused = false;
+    try{
+        ShmEventSource<Ev> other(name, 4);
+    }catch(const std::system_error& e){
+        refused = e.code() == std::errc::file_exists;
+    }
+    assert(refused);
+    ShmEventEmitter<Ev> emitter(name);
+    assert(emitter.tryEmit(second));
+    Ev event;
+    assert(source.tryPop(event) && event == second);
+}
+
+// A producer dying with the ring mutex held does not block the others
+void deadProducer(){
+    ShmEventSource<Ev> source(name, 4);
+    pid_t child = fork();
+    if(child == 0){
+        pthread_mutex_lock(&mapHeader()->mutex);
+        _exit(0);
+    }
+    waitpid(child, nullptr, 0);
+    ShmEventEmitter<Ev> emitter(name);
+    assert(emitter.tryEmit(third));
+    Ev event;
+    assert(source.tryPop(event) && event == third);
+    assert(!source.tryPop(event));
+}
+
+// Emitters of a dead source fail, and the segment can be created again
+void deadOwner(){
+    int ready[2];
+    assert(pipe(ready) == 0);
+    pid_t child = fork();
+    if(child == 0){
+        ShmEventSource<Ev> source(name, 2);
+        char c = 1;
+        if(write(ready[1], &c, 1) != 1){
+            _exit(1);
+        }
+        pause();
+        _exit(0);
+    }
+    char c;
+    assert(read(ready[0], &c, 1) == 1);
+    ShmEventEmitter<Ev> emitter(name);
+    emitter.emit(first);
+    emitter.emit(first);
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+
+    bool orphaned = false;
+    try{
+        emitter.emit(first);
+    }catch(const std::runtime_error&){
+        orphaned = true;
+    }
+    assert(orphaned);
+
+    ShmEventSource<Ev> source(name, 2);
+    bool closed = false;
+    try{
+        emitter.tryEmit(first);
+    }catch(const std::runtime_error&){
+        closed = true;
+    }
+    assert(closed);
+    ShmEventEmitter<Ev> fresh(name);
+    assert(fresh.tryEmit(second));
+    Ev event;
+    assert(source.tryPop(event) && event == second);
+    close(ready[0]);
+    close(ready[1]);
+}
+
+// Several consumers together pop every event exactly once
+void consumers(){
+    constexpr std::uint32_t count = 100000;
+    constexpr std::size_t threads = 4;
+    ShmEventSource<Ev> source(name, 8);
+    std::vector<std::atomic<std::uint32_t> > seen(count);
+    std::atomic<std::uint32_t> popped{0};
+    std::vector<std::thread> pool;
+    for(std::size_t i = 0; i != threads; ++i){
+        pool.emplace_back([&]{
+            while(popped.load() != count){
+                Ev event;
+                if(source.tryPop(event)){
+                    seen[event].fetch_add(1);
+                    popped.fetch_add(1);
+                }
+            }
+        });
+    }
+    ShmEventEmitter<Ev> emitter(name);
+    for(std::uint32_t i = 0; i != count; ++i){
+        emitter.emit(static_cast<Ev>(i));
+    }
+    for(auto& t: pool){
+        t.join();
+    }
+    for(auto& n: seen){
+        assert(n.load() == 1);
+    }
+}
+
+int main(){
+    shm_unlink(name);
+    liveOwner();
+    deadProducer();
+    deadOwner();
+    consumers();
+    std::cout << "evtShm passed" << std::endl;
+}
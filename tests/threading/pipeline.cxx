@@ -0,0 +1,120 @@
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "pipeline.h"
+
+enum ParseEv{parse};
+enum StoreEv{store};
+
+EventEngine<StoreEv>* storeStage;
+std::atomic<std::size_t> stored{0};
+
+std::array<void(*)(), 1> parseCbs{
+    []{
+        storeStage->emit(store);
+    }
+};
+
+// Slower than the producer, so its queue stays full
+std::array<void(*)(), 1> storeCbs{
+    []{
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+        stored.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+// Events flow through both stages, the controller grows the batch of the
+// saturated stage and keeps the idle one at 1
+void flow(){
+    Pipeline pipe(std::chrono::microseconds(1), std::chrono::milliseconds(20));
+    auto& parser = pipe.stage<ParseEv>("parse", 64, 1, [](EventEngine<ParseEv>& e){
+        e.ignite(parseCbs.data());
+    });
+    auto& storer = pipe.stage<StoreEv>("store", 64, 2, [](EventEngine<StoreEv>& e){
+        e.ignite(storeCbs.data());
+    });
+    storeStage = &storer;
+
+    std::mutex mutex;
+    std::size_t reports = 0;
+    std::size_t maxStoreBatch = 0;
+    pipe.report([&](const std::vector<Pipeline::Stats>& stats){
+        assert(stats.size() == 2);
+        assert(stats[0].name == "parse" && stats[1].name == "store");
+        std::lock_guard<std::mutex> lk(mutex);
+        ++reports;
+        maxStoreBatch = stats[1].batch > maxStoreBatch ? stats[1].batch : maxStoreBatch;
+    });
+
+    bool rejected = false;
+    pipe.start();
+    try{
+        pipe.stage<StoreEv>("late", 8, 1, [](EventEngine<StoreEv>&){});
+    }catch(const std::logic_error&){
+        rejected = true;
+    }
+    assert(rejected);
+
+    // Feed until the controller has sampled the saturated stage a while
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    std::size_t emitted = 0;
+    for(;;){
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            if((reports >= 5 && maxStoreBatch > 1) || std::chrono::steady_clock::now() > deadline){
+                break;
+            }
+        }
+        parser.emit(parse);
+        ++emitted;
+    }
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        assert(maxStoreBatch > 1);
+    }
+    std::vector<Pipeline::Stats> stats = pipe.stats();
+    assert(stats.size() == 2 && stats[1].processed != 0);
+    assert(stats[1].delay > std::chrono::microseconds(1));
+
+    const std::size_t discarded = pipe.stop();
+    // Every event emitted is either stored or discarded, except for the
+    // batch the parse thread had dequeued, which it hands to a closed
+    // store queue
+    const std::size_t accounted = stored.load() + discarded;
+    assert(accounted <= emitted && accounted + 64 >= emitted);
+    assert(pipe.stop() == 0);
+
+    rejected = false;
+    try{
+        pipe.start();
+    }catch(const std::logic_error&){
+        rejected = true;
+    }
+    assert(rejected);
+}
+
+// A stage that keeps up is kept at batch size 1
+void idle(){
+    Pipeline pipe(std::chrono::milliseconds(100), std::chrono::milliseconds(10));
+    auto& storer = pipe.stage<StoreEv>("store", 64, 1, [](EventEngine<StoreEv>& e){
+        e.ignite(storeCbs.data());
+    });
+    storer.batch(8);
+    pipe.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    assert(storer.batch() == 1);
+    assert(pipe.stop() == 0);
+}
+
+int main(){
+    flow();
+    idle();
+    std::cout << "pipeline passed" << std::endl;
+}
@@ -0,0 +1,279 @@
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tracer.h"
+
+// Just enough of a JSON parser to check dumps: strict syntax, objects keep
+// their members, numbers are kept as text
+struct Json{
+    enum Type{null, boolean, number, string, array, object} type = null;
+    std::string text;
+    std::vector<Json> items;
+    std::map<std::string, Json> members;
+
+    const Json& operator[](const std::string& key) const{
+        auto it = members.find(key);
+        assert(it != members.end());
+        return it->second;
+    }
+    bool has(const std::string& key) const{
+        return members.count(key) != 0;
+    }
+};
+
+class JsonParser{
+  public:
+    explicit JsonParser(const std::string& in): in(in), pos(0){}
+
+    Json parse(){
+        Json value = parseValue();
+        space();
+        assert(pos == in.size());
+        return value;
+    }
+
+  private:
+    const std::string& in;
+    std::size_t pos;
+
+    void space(){
+        while(pos != in.size() && (in[pos] == ' ' || in[pos] == '\n' || in[pos] == '\t' || in[pos] == '\r')){
+            ++pos;
+        }
+    }
+
+    void expect(char c){
+        space();
+        assert(pos != in.size() && in[pos] == c);
+        ++pos;
+    }
+
+    Json parseValue(){
+        space();
+        assert(pos != in.size());
+        Json value;
+        const char c = in[pos];
+        if(c == '{'){
+            value.type = Json::object;
+            ++pos;
+            space();
+            if(in[pos] == '}'){
+                ++pos;
+                return value;
+            }
+            do{
+                space();
+                const std::string key = parseString();
+                expect(':');
+                assert(!value.has(key));
+                value.members[key] = parseValue();
+                space();
+            }while(in[pos++] == ',');
+            assert(in[pos - 1] == '}');
+        }else if(c == '['){
+            value.type = Json::array;
+            ++pos;
+            space();
+            if(in[pos] == ']'){
+                ++pos;
+                return value;
+            }
+            do{
+                value.items.push_back(parseValue());
+                space();
+            }while(in[pos++] == ',');
+            assert(in[pos - 1] == ']');
+        }else if(c == '"'){
+            value.type = Json::string;
+            value.text = parseString();
+        }else{
+            value.type = Json::number;
+            const std::size_t begin = pos;
+            if(in[pos] == '-'){
+                ++pos;
+            }
+            assert(pos != in.size() && std::isdigit(static_cast<unsigned char>(in[pos])));
+            while(pos != in.size() && (std::isdigit(static_cast<unsigned char>(in[pos])) || in[pos] == '.')){
+                ++pos;
+            }
+            value.text = in.substr(begin, pos - begin);
+        }
+        return value;
+    }
+
+    std::string parseString(){
+        assert(in[pos] == '"');
+        ++pos;
+        std::string out;
+        while(true){
+            assert(pos != in.size());
+            const char c = in[pos++];
+            assert(static_cast<unsigned char>(c) >= 0x20);
+            if(c == '"'){
+                return out;
+            }
+            if(c != '\\'){
+                out += c;
+                continue;
+            }
+            const char e = in[pos++];
+            if(e == 'u'){
+                out += static_cast<char>(std::stoi(in.substr(pos, 4), nullptr, 16));
+                pos += 4;
+            }else{
+                assert(e == '"' || e == '\\' || e == '/');
+                out += e;
+            }
+        }
+    }
+};
+
+struct Slice{
+    std::string name;
+    double ts;
+};
+
+// Parse a dump and check every thread's B/E records pair up; returns the
+// begin records per thread in order, thread names in names
+std::map<std::string, std::vector<Slice> > check(std::map<std::string, std::string>& names){
+    std::ostringstream out;
+    Tracer::dump(out);
+    const Json trace = JsonParser(out.str()).parse();
+    assert(trace["displayTimeUnit"].text == "ns");
+    std::map<std::string, std::vector<Slice> > begins;
+    std::map<std::string, std::vector<std::string> > open;
+    for(const Json& event: trace["traceEvents"].items){
+        const std::string tid = event["tid"].text;
+        const std::string ph = event["ph"].text;
+        if(ph == "M"){
+            assert(event["name"].text == "thread_name");
+            names[tid] = event["args"]["name"].text;
+        }else if(ph == "B"){
+            open[tid].push_back(event["name"].text);
+            begins[tid].push_back(Slice{event["name"].text, std::stod(event["ts"].text)});
+        }else{
+            assert(ph == "E");
+            assert(!open[tid].empty());
+            assert(open[tid].back() == event["name"].text);
+            open[tid].pop_back();
+        }
+    }
+    return begins;
+}
+
+std::map<std::string, std::vector<Slice> > check(){
+    std::map<std::string, std::string> names;
+    return check(names);
+}
+
+// Names with quotes, backslashes and control characters survive the dump
+void naming(){
+    Tracer::clear();
+    const std::string odd = "main \"loop\" \\ tab\there\n";
+    Tracer::name(odd);
+    std::thread t([]{
+        Tracer::name("worker");
+        Tracer::record(TraceKind::park);
+        Tracer::record(TraceKind::wake);
+    });
+    t.join();
+    Tracer::record(TraceKind::handlerBegin, 1);
+    Tracer::record(TraceKind::handlerEnd, 1);
+
+    std::map<std::string, std::string> names;
+    auto begins = check(names);
+    bool main = false, worker = false;
+    for(auto& n: names){
+        main |= n.second == odd;
+        worker |= n.second == "worker";
+    }
+    assert(main && worker);
+    std::size_t parked = 0, events = 0;
+    for(auto& thread: begins){
+        for(auto& slice: thread.second){
+            parked += slice.name == "parked";
+            events += slice.name == "event 1";
+        }
+    }
+    assert(parked == 1 && events == 1);
+}
+
+// A full ring keeps the latest capacity records, the end whose begin was
+// overwritten is left out and the open slice at the end is kept
+void wraparound(){
+    Tracer::clear();
+    const std::size_t total = 2 * Tracer::capacity + 3;
+    for(std::size_t i = 0; i != total; ++i){
+        Tracer::record(i % 2 ? TraceKind::handlerEnd : TraceKind::handlerBegin,
+                       static_cast<std::uint32_t>(i / 2));
+    }
+    auto begins = check();
+    assert(begins.size() == 1);
+    const auto& slices = begins.begin()->second;
+    assert(slices.size() == Tracer::capacity / 2);
+    // Records are kept in order, the oldest surviving begin is 8196 / 2
+    for(std::size_t i = 0; i != slices.size(); ++i){
+        assert(slices[i].name == "event " + std::to_string((total - Tracer::capacity + 1) / 2 + i));
+        assert(i == 0 || slices[i].ts >= slices[i - 1].ts);
+    }
+}
+
+// clear() drops held records and the rings of exited threads
+void clearing(){
+    std::thread t([]{
+        Tracer::record(TraceKind::blockBegin);
+        Tracer::record(TraceKind::blockEnd);
+    });
+    t.join();
+    Tracer::record(TraceKind::handlerBegin, 7);
+    assert(check().size() >= 2);
+
+    Tracer::clear();
+    assert(check().empty());
+    // Ends of slices begun before clear() are left out
+    Tracer::record(TraceKind::handlerEnd, 7);
+    Tracer::record(TraceKind::handlerBegin, 8);
+    Tracer::record(TraceKind::handlerEnd, 8);
+    auto begins = check();
+    assert(begins.size() == 1);
+    assert(begins.begin()->second.size() == 1 && begins.begin()->second[0].name == "event 8");
+}
+
+// Dumps taken while a thread keeps overwriting its ring stay well formed
+void concurrent(){
+    Tracer::clear();
+    std::atomic<bool> done{false};
+    std::thread t([&done]{
+        for(std::uint32_t i = 0; !done.load(std::memory_order_relaxed); ++i){
+            Tracer::record(TraceKind::handlerBegin, i);
+            Tracer::record(TraceKind::handlerEnd, i);
+        }
+    });
+    for(int i = 0; i != 20; ++i){
+        check();
+    }
+    done = true;
+    t.join();
+}
+
+int main(){
+    Tracer::enable(true);
+    naming();
+    wraparound();
+    clearing();
+    concurrent();
+    Tracer::enable(false);
+    Tracer::record(TraceKind::handlerBegin, 9);
+    Tracer::clear();
+    assert(check().empty());
+    std::cout << "tracer passed" << std::endl;
+}